@@ -0,0 +1,463 @@
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "acquisition_daemon.hpp"
+
+
+// Set by SIGINT / SIGTERM while the daemon runs
+static volatile std::sig_atomic_t signal_stop = 0;
+
+static void OnSignal(int)
+{
+	signal_stop = 1;
+}
+
+
+AcquisitionDaemon::AcquisitionDaemon()
+	: stop(false)
+{
+	client = new Client[max_client];
+}
+
+
+AcquisitionDaemon::~AcquisitionDaemon()
+{
+	Close();
+	delete[] client;
+}
+
+
+/*
+@brief	Create the control socket & set up the processing of the frames
+
+@param[in]	socket_path		path of the Unix domain socket, e.g. "/tmp/foot_sensor.sock" (replaced if it exists)
+@param[in]	foot_sensor		foot-sensor, already initialized (FilterSpike_Init, filters, gait events...)
+@param[in]	serial_port		serial ports of the foot-sensor, already open
+@param[in]	pressure_data	frame state of the foot-sensor, already initialized (FilterSpike_Init sizes the pixel matrices)
+@return	false if the socket cannot be created (or not on POSIX)
+*/
+bool AcquisitionDaemon::Open(const char* socket_path, FootSensor* foot_sensor, USBStream* serial_port, PressureData* pressure_data)
+{
+	Close();
+
+#if defined(__unix__)
+	if (strlen(socket_path) >= sizeof(sockaddr_un::sun_path))
+	{
+		std::cerr << "AcquisitionDaemon: socket path too long " << socket_path << std::endl;
+		return false;
+	}
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0)
+	{
+		std::cerr << "AcquisitionDaemon: socket failed (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+	unlink(socket_path);
+
+	if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, max_client) != 0)
+	{
+		std::cerr << "AcquisitionDaemon: cannot listen on " << socket_path << " (" << strerror(errno) << ")" << std::endl;
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+	strncpy(this->socket_path, socket_path, sizeof(this->socket_path) - 1);
+
+	// The frames are processed once here, whatever the clients subscribe to
+	this->foot_sensor = foot_sensor;
+	this->serial_port = serial_port;
+	this->pressure_data = pressure_data;
+	foot_sensor->RegisterMetrics(&metric_graph, serial_port);
+	metric_graph.Subscribe("cop_kalman");
+	metric_graph.Subscribe("contact");
+	metric_graph.Subscribe("filtered_cop");
+	metric_graph.Subscribe("gait_events");
+	metric_graph.Subscribe("history");		// packs the PressureFrame that is streamed
+
+	stop = false;
+	return true;
+#else
+	std::cerr << "AcquisitionDaemon: Unix domain sockets are not available" << std::endl;
+	return false;
+#endif
+}
+
+
+/*
+@brief	Read, process & stream the frames until RequestStop(), SIGINT or SIGTERM
+The loop is paced by the foot-sensors : the sockets are only polled (never waited for) between 2 frames.
+*/
+void AcquisitionDaemon::Run()
+{
+#if defined(__unix__)
+	if (listen_fd < 0)
+		return;
+
+	signal_stop = 0;
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	pollfd fds[max_client + 1];
+	int fd_client[max_client + 1];
+
+	while (!stop && !signal_stop)
+	{
+		// Read the foot-sensors & process the frame
+		metric_graph.Evaluate(pressure_data);
+
+		const GaitEventRecord* events;
+		int num_event = foot_sensor->getFrameEvents(&events);
+		Broadcast(foot_sensor->getHistory()->newest(), events, num_event);
+
+		// New clients, commands, and the output still pending
+		int num_fd = 0;
+		fds[num_fd].fd = listen_fd;
+		fds[num_fd].events = POLLIN;
+		fd_client[num_fd++] = -1;
+		for (int i = 0; i < max_client; i++)
+		{
+			if (client[i].fd < 0)
+				continue;
+			fds[num_fd].fd = client[i].fd;
+			fds[num_fd].events = POLLIN | ((client[i].out_end > client[i].out_begin) ? POLLOUT : 0);
+			fd_client[num_fd++] = i;
+		}
+
+		if (poll(fds, num_fd, 0) <= 0)
+			continue;
+
+		for (int i = 1; i < num_fd; i++)
+		{
+			Client* c = &client[fd_client[i]];
+			if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+				Disconnect(c);
+			else
+			{
+				if (fds[i].revents & POLLOUT)
+					Flush(c);
+				if (fds[i].revents & POLLIN)
+					Receive(c);
+			}
+		}
+		if (fds[0].revents & POLLIN)
+			Accept();
+	}
+
+	std::signal(SIGINT, SIG_DFL);
+	std::signal(SIGTERM, SIG_DFL);
+#endif
+}
+
+
+/*
+@brief	Disconnect all clients & remove the socket
+*/
+void AcquisitionDaemon::Close()
+{
+	for (int i = 0; i < max_client; i++)
+		Disconnect(&client[i]);
+
+#if defined(__unix__)
+	if (listen_fd >= 0)
+	{
+		close(listen_fd);
+		unlink(socket_path);
+	}
+#endif
+	listen_fd = -1;
+	socket_path[0] = 0;
+}
+
+
+int AcquisitionDaemon::getNumClient()
+{
+	int num_client = 0;
+	for (int i = 0; i < max_client; i++)
+		num_client += (client[i].fd >= 0);
+	return num_client;
+}
+
+
+/*
+@brief	Accept the pending connections (refused when all slots are used)
+This is an internal function.
+*/
+void AcquisitionDaemon::Accept()
+{
+#if defined(__unix__)
+	while (true)
+	{
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		Client* c = NULL;
+		for (int i = 0; i < max_client && !c; i++)
+		{
+			if (client[i].fd < 0)
+				c = &client[i];
+		}
+		if (!c)
+		{
+			close(fd);
+			continue;
+		}
+
+		c->fd = fd;
+		c->streams = kStreamScalars | kStreamEvents;
+		c->decimation = 1;
+		c->sent = 0;
+		c->dropped = 0;
+		c->out_begin = 0;
+		c->out_end = 0;
+		c->in_size = 0;
+		c->num_frame = 0;
+	}
+#endif
+}
+
+
+/*
+@brief	Read the commands of a client, line by line
+This is an internal function.
+*/
+void AcquisitionDaemon::Receive(Client* c)
+{
+#if defined(__unix__)
+	while (c->fd >= 0)
+	{
+		ssize_t n = recv(c->fd, c->in + c->in_size, in_buffer_size - 1 - c->in_size, 0);
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+		{
+			Disconnect(c);
+			return;
+		}
+		if (n < 0)
+			return;
+		c->in_size += (int)n;
+
+		// Execute the complete lines
+		int begin = 0;
+		for (int i = 0; i < c->in_size && c->fd >= 0; i++)
+		{
+			if (c->in[i] != '\n')
+				continue;
+			c->in[i] = 0;
+			if (i > begin && c->in[i - 1] == '\r')
+				c->in[i - 1] = 0;
+			Command(c, c->in + begin);
+			begin = i + 1;
+		}
+		if (c->fd < 0)
+			return;
+
+		c->in_size -= begin;
+		memmove(c->in, c->in + begin, c->in_size);
+
+		// A line longer than the buffer is not a command
+		if (c->in_size >= in_buffer_size - 1)
+			c->in_size = 0;
+	}
+#endif
+}
+
+
+/*
+@brief	Execute one command of a client, see the wire format in acquisition_daemon.hpp
+This is an internal function.
+*/
+void AcquisitionDaemon::Command(Client* c, const char* line)
+{
+	char reply[128];
+
+	if (strncmp(line, "filter ", 7) == 0)
+	{
+		unsigned streams = 0;
+		if (strstr(line + 7, "raw"))
+			streams |= kStreamRaw;
+		if (strstr(line + 7, "scalars"))
+			streams |= kStreamScalars;
+		if (strstr(line + 7, "events"))
+			streams |= kStreamEvents;
+
+		if (streams)
+		{
+			c->streams = streams;
+			snprintf(reply, sizeof(reply), "ok filter %u", streams);
+		}
+		else
+			snprintf(reply, sizeof(reply), "error filter : raw, scalars or events");
+	}
+	else if (strncmp(line, "decimate ", 9) == 0)
+	{
+		int decimation = atoi(line + 9);
+		if (decimation >= 1)
+		{
+			c->decimation = decimation;
+			snprintf(reply, sizeof(reply), "ok decimate %d", decimation);
+		}
+		else
+			snprintf(reply, sizeof(reply), "error decimate : n >= 1");
+	}
+	else if (strcmp(line, "stats") == 0)
+		snprintf(reply, sizeof(reply), "ok sent %llu dropped %llu clients %d",
+			(unsigned long long)c->sent, (unsigned long long)c->dropped, getNumClient());
+	else if (strcmp(line, "quit") == 0)
+	{
+		Disconnect(c);
+		return;
+	}
+	else if (line[0] == 0)
+		return;
+	else
+		snprintf(reply, sizeof(reply), "error unknown command");
+
+	Send(c, kDaemonReply, reply, (int)strlen(reply));
+}
+
+
+/*
+@brief	Queue one message for a client & try to send it right away
+The message is dropped (and counted) if the output buffer of the client is full : a slow client only loses its own messages.
+This is an internal function.
+
+@return	false if the message is dropped
+*/
+bool AcquisitionDaemon::Send(Client* c, uint16_t type, const void* payload, int size)
+{
+	int message_size = sizeof(DaemonHeader) + size;
+	if (c->out_end + message_size > out_buffer_size)
+	{
+		// Make room at the end with the bytes already sent
+		memmove(c->out, c->out + c->out_begin, c->out_end - c->out_begin);
+		c->out_end -= c->out_begin;
+		c->out_begin = 0;
+		if (c->out_end + message_size > out_buffer_size)
+		{
+			c->dropped++;
+			return false;
+		}
+	}
+
+	DaemonHeader header;
+	header.magic = DaemonMagic;
+	header.type = type;
+	header.size = (uint16_t)size;
+	memcpy(c->out + c->out_end, &header, sizeof(header));
+	memcpy(c->out + c->out_end + sizeof(header), payload, size);
+	c->out_end += message_size;
+	c->sent++;
+
+	Flush(c);
+	return true;
+}
+
+
+/*
+@brief	Send as much of the output buffer as the socket takes, without waiting
+This is an internal function.
+*/
+void AcquisitionDaemon::Flush(Client* c)
+{
+#if defined(__unix__)
+	while (c->fd >= 0 && c->out_end > c->out_begin)
+	{
+		ssize_t n = send(c->fd, c->out + c->out_begin, c->out_end - c->out_begin, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				Disconnect(c);
+			return;
+		}
+		c->out_begin += (int)n;
+	}
+	if (c->out_begin == c->out_end)
+		c->out_begin = c->out_end = 0;
+#endif
+}
+
+
+/*
+@brief	Close the connection of a client & free its slot
+This is an internal function.
+*/
+void AcquisitionDaemon::Disconnect(Client* c)
+{
+#if defined(__unix__)
+	if (c->fd >= 0)
+		close(c->fd);
+#endif
+	c->fd = -1;
+	c->out_begin = c->out_end = 0;
+	c->in_size = 0;
+}
+
+
+/*
+@brief	Send one processed frame to every client, as filtered & decimated by the client
+This is an internal function.
+*/
+void AcquisitionDaemon::Broadcast(const PressureFrame& frame, const GaitEventRecord* events, int num_event)
+{
+	DaemonScalars scalars;
+	memset(&scalars, 0, sizeof(scalars));
+	scalars.time_stamp = frame.time_stamp;
+	scalars.seq = frame.seq;
+	scalars.event_flags = frame.event_flags;
+	for (int foot = 0; foot < 2; foot++)
+	{
+		scalars.gait_phase[foot] = frame.gait_phase[foot];
+		scalars.pressure[foot] = frame.pressure[foot];
+		scalars.cop_x[foot] = frame.cop_x[foot];
+		scalars.cop_y[foot] = frame.cop_y[foot];
+	}
+
+	for (int i = 0; i < max_client; i++)
+	{
+		Client* c = &client[i];
+		if (c->fd < 0)
+			continue;
+
+		// Events are never decimated
+		if (c->streams & kStreamEvents)
+		{
+			for (int e = 0; e < num_event && c->fd >= 0; e++)
+			{
+				DaemonEvent event;
+				event.time_stamp = events[e].time_stamp;
+				event.frame_seq = frame.seq;
+				event.event = events[e].event;
+				event.foot = events[e].foot;
+				event.confidence = events[e].confidence;
+				Send(c, kDaemonEvent, &event, sizeof(event));
+			}
+		}
+
+		if (c->num_frame++ % c->decimation != 0 || c->fd < 0)
+			continue;
+
+		if (c->streams & kStreamScalars)
+			Send(c, kDaemonScalars, &scalars, sizeof(scalars));
+		if ((c->streams & kStreamRaw) && c->fd >= 0)
+			Send(c, kDaemonFrame, &frame, sizeof(frame));
+	}
+}
@@ -0,0 +1,144 @@
+#ifndef ACQUISITION_DAEMON_HPP
+#define ACQUISITION_DAEMON_HPP
+
+#include <stdint.h>
+#include <atomic>
+
+#include "foot_sensor.hpp"
+
+
+/** Wire format of the acquisition daemon (little-endian, packed as below)
+*
+* Client -> daemon : text commands, one per line
+*	filter <raw|scalars|events>[,...]	select the streams (default : scalars,events)
+*	decimate <n>						send 1 frame out of n (raw & scalars ; events are never decimated)
+*	stats								reply with the counters of this client
+*	quit								close the connection
+*
+* Daemon -> client : binary messages, each one a DaemonHeader followed by "size" bytes of payload
+*	kDaemonFrame	-> PressureFrame (all cells)
+*	kDaemonScalars	-> DaemonScalars
+*	kDaemonEvent	-> DaemonEvent
+*	kDaemonReply	-> text reply of a command (not null-terminated)
+*/
+enum DaemonMessage
+{
+	kDaemonFrame = 1,
+	kDaemonScalars = 2,
+	kDaemonEvent = 3,
+	kDaemonReply = 4
+};
+
+// Subscription filter of a client
+enum DaemonStream
+{
+	kStreamRaw = 1,
+	kStreamScalars = 2,
+	kStreamEvents = 4
+};
+
+struct DaemonHeader
+{
+	uint32_t magic;		// DaemonMagic
+	uint16_t type;		// DaemonMessage
+	uint16_t size;		// payload size in bytes
+};
+
+// Per-frame values without the cells
+struct DaemonScalars
+{
+	double time_stamp;
+	uint32_t seq;
+	uint16_t event_flags;
+	uint8_t gait_phase[2];
+	float pressure[2];
+	float cop_x[2];
+	float cop_y[2];
+};
+
+struct DaemonEvent
+{
+	double time_stamp;
+	uint32_t frame_seq;
+	int32_t event;		// GaitEvent
+	int32_t foot;		// 1 -> left ; 2 -> right
+	float confidence;
+};
+
+static const uint32_t DaemonMagic = 0x46534431;	// "FSD1"
+
+
+/**
+* Acquisition daemon : owns the serial ports, processes every frame once and streams it to local clients
+*
+* Recording, visualisation & control can then run side by side as separate processes.
+* Clients connect to a Unix domain socket, choose their streams & decimation, and receive binary messages.
+* All sockets are non-blocking : each client has a fixed output buffer, and a message that does not fit
+* is dropped (and counted) for that client only, so a slow client never stalls the acquisition.
+*/
+class AcquisitionDaemon
+{
+public:
+	static const int max_client = 16;
+	static const int out_buffer_size = 64 * 1024;
+	static const int in_buffer_size = 256;
+
+	AcquisitionDaemon();
+	~AcquisitionDaemon();
+
+	bool Open(const char* socket_path, FootSensor* foot_sensor, USBStream* serial_port, PressureData* pressure_data);
+
+	void Run();
+
+	void RequestStop() { stop = true; }
+
+	void Close();
+
+	int getNumClient();
+
+private:
+	struct Client
+	{
+		int fd = -1;
+		unsigned streams = kStreamScalars | kStreamEvents;
+		int decimation = 1;
+		uint64_t sent = 0;			// messages
+		uint64_t dropped = 0;		// messages that did not fit in the output buffer
+
+		char out[out_buffer_size];
+		int out_begin = 0;
+		int out_end = 0;
+
+		char in[in_buffer_size];
+		int in_size = 0;
+
+		uint64_t num_frame = 0;		// frames seen since connection, for the decimation
+	};
+
+	char socket_path[108] = { 0 };
+	int listen_fd = -1;
+	Client* client;				// max_client slots, allocated once (64 kB of output buffer each)
+	std::atomic<bool> stop;
+
+	FootSensor* foot_sensor = NULL;
+	USBStream* serial_port = NULL;
+	PressureData* pressure_data = NULL;
+	MetricGraph metric_graph;
+
+	void Accept();
+
+	void Receive(Client* c);
+
+	void Command(Client* c, const char* line);
+
+	bool Send(Client* c, uint16_t type, const void* payload, int size);
+
+	void Flush(Client* c);
+
+	void Disconnect(Client* c);
+
+	void Broadcast(const PressureFrame& frame, const GaitEventRecord* events, int num_event);
+};
+
+
+#endif // ACQUISITION_DAEMON_HPP
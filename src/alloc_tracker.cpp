@@ -0,0 +1,254 @@
+#include "alloc_tracker.hpp"
+
+#if defined(ALLOC_TRACKER)
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "Eigen/Core"
+
+#if !defined(EIGEN_RUNTIME_NO_MALLOC)
+#error "ALLOC_TRACKER needs EIGEN_RUNTIME_NO_MALLOC on every file, see CMakeLists.txt"
+#endif
+
+
+// State of the calling thread (plain thread_local PODs : no allocation to access them)
+static thread_local bool armed = false;
+static thread_local bool abort_on_allocation = true;
+
+// Allocations made while armed, all threads
+static std::atomic<uint64_t> num_allocation(0);
+
+
+/*
+@brief	Start checking the allocations of the calling thread
+
+Dynamic Eigen matrices do not go through operator new (Eigen::internal::aligned_malloc() calls malloc) :
+they are refused by Eigen itself, which can only abort. Eigen's switch is process-wide, so while armed,
+a dynamic Eigen allocation on ANY thread aborts.
+
+@param[in]	abort_on_allocation		true -> abort at the 1st allocation (operator new or Eigen) ;
+									false -> only count them (operator new only, Eigen is not checked)
+*/
+void AllocTracker::Arm(bool abort_on_allocation)
+{
+	::abort_on_allocation = abort_on_allocation;
+	armed = true;
+	if (abort_on_allocation)
+		Eigen::internal::set_is_malloc_allowed(false);
+}
+
+
+/*
+@brief	Stop checking the allocations of the calling thread
+*/
+void AllocTracker::Disarm()
+{
+	armed = false;
+	Eigen::internal::set_is_malloc_allowed(true);
+}
+
+
+bool AllocTracker::isArmed()
+{
+	return armed;
+}
+
+
+/*
+@brief	Number of allocations made while armed, by all threads
+*/
+uint64_t AllocTracker::getNumAllocation()
+{
+	return num_allocation.load(std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Count (or refuse) one allocation
+This is an internal function.
+*/
+static void Check(std::size_t size)
+{
+	if (armed)
+	{
+		num_allocation.fetch_add(1, std::memory_order_relaxed);
+		if (abort_on_allocation)
+		{
+			armed = false;	// fprintf may allocate
+			std::fprintf(stderr, "AllocTracker: allocation of %zu bytes in the steady-state loop\n", size);
+			std::abort();
+		}
+	}
+}
+
+
+/*
+@brief	Count (or refuse) one allocation & allocate it
+This is an internal function.
+*/
+static void* Allocate(std::size_t size)
+{
+	Check(size);
+
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+
+#if defined(__cpp_aligned_new)
+/*
+@brief	Same as Allocate(), for over-aligned types (alignas larger than the default, e.g. the cache-line aligned queues)
+This is an internal function.
+*/
+static void* AllocateAligned(std::size_t size, std::size_t alignment)
+{
+	Check(size);
+
+	if (alignment < sizeof(void*))
+		alignment = sizeof(void*);
+#if defined(_WIN32) || defined(WIN32)
+	void* p = _aligned_malloc(size ? size : 1, alignment);
+#else
+	void* p = NULL;
+	if (posix_memalign(&p, alignment, size ? size : 1) != 0)
+		p = NULL;
+#endif
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+
+/*
+@brief	Free a block of AllocateAligned()
+This is an internal function.
+*/
+static void FreeAligned(void* p)
+{
+#if defined(_WIN32) || defined(WIN32)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+#endif // __cpp_aligned_new
+
+
+void* operator new(std::size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateAligned(size, static_cast<std::size_t>(alignment));
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateAligned(size, static_cast<std::size_t>(alignment));
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+#endif // __cpp_aligned_new
+
+
+#endif // ALLOC_TRACKER
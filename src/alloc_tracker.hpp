@@ -0,0 +1,43 @@
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+
+#include <stdint.h>
+
+
+/**
+* Test-mode check that the steady-state loop never allocates
+*
+* Built with ALLOC_TRACKER defined (cmake -DALLOC_TRACKER=ON), the global operator new / new[] (also the aligned ones)
+* are replaced : while the calling thread is armed, every allocation is counted and, by default, aborts the program
+* with a message, so a regression on the hot path fails right away instead of showing up as p99 jitter.
+* Dynamic Eigen matrices allocate with malloc, not new : the same build defines EIGEN_RUNTIME_NO_MALLOC
+* (with assertions on), and Arm() makes Eigen refuse them (see Arm()).
+* Without ALLOC_TRACKER, all functions are empty and operator new is untouched.
+*
+* Arm() / Disarm() only concern the calling thread, e.g. around the per-frame calculations after a few warm-up frames
+* (buffers reach their final size during the 1st frames).
+*/
+class AllocTracker
+{
+public:
+#if defined(ALLOC_TRACKER)
+	static void Arm(bool abort_on_allocation = true);
+
+	static void Disarm();
+
+	static bool isArmed();
+
+	static uint64_t getNumAllocation();
+#else
+	static void Arm(bool /*abort_on_allocation*/ = true) {}
+
+	static void Disarm() {}
+
+	static bool isArmed() { return false; }
+
+	static uint64_t getNumAllocation() { return 0; }
+#endif
+};
+
+
+#endif // ALLOC_TRACKER_HPP
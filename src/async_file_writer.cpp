@@ -0,0 +1,208 @@
+#include <chrono>
+#include <cstring>
+
+#include "async_file_writer.hpp"
+#include "trace.hpp"
+
+
+static int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+AsyncFileWriter::AsyncFileWriter()
+	: head(0), tail(0), flush_request(false), records(0), dropped(0), blocked(0), blocks(0),
+	write_ns(0), max_write_ns(0), max_queue_bytes(0), running(false)
+{
+	ring = new char[ring_size];
+}
+
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+	Stop();
+	delete[] ring;
+}
+
+
+/*
+@brief	Start the writer thread on an open file
+
+@param[in]	file			file written by the thread until Stop()
+@param[in]	policy			what Write() does when the ring is full
+@param[in]	block_size		bytes waiting that trigger a block write
+@param[in]	flush_interval	max time a record waits in the ring (in seconds)
+@return	false if already running
+*/
+bool AsyncFileWriter::Start(std::ofstream* file, WritePolicy policy, int block_size, double flush_interval)
+{
+	if (running.load())
+		return false;
+
+	this->file = file;
+	this->policy = policy;
+	this->block_size = block_size;
+	flush_interval_ns = int64_t(flush_interval * 1e9);
+
+	// The ring is empty after Stop() ; counters accumulate over the restarts (e.g. one per file)
+	flush_request = false;
+	running = true;
+	thread = std::thread(&AsyncFileWriter::Run, this);
+	return true;
+}
+
+
+/*
+@brief	Write everything still queued, then stop the writer thread
+*/
+void AsyncFileWriter::Stop()
+{
+	if (!running.load())
+		return;
+
+	Flush();
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+
+/*
+@brief	Queue one record (caller thread, never touches the file)
+
+@param[in]	data	the record, copied
+@param[in]	size	bytes of the record
+@return	false if the record is dropped (ring full with kWriteDrop, or not running)
+*/
+bool AsyncFileWriter::Write(const char* data, int size)
+{
+	if (!running.load(std::memory_order_relaxed) || size > ring_size)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint64_t h = head.load(std::memory_order_relaxed);
+	if (h + size - tail.load(std::memory_order_acquire) > (uint64_t)ring_size)
+	{
+		if (policy == kWriteDrop)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		blocked.fetch_add(1, std::memory_order_relaxed);
+		while (h + size - tail.load(std::memory_order_acquire) > (uint64_t)ring_size)
+			std::this_thread::yield();
+	}
+
+	// Copy in 2 parts if the record wraps around the end of the ring
+	int begin = (int)(h & (ring_size - 1));
+	int first = (size < ring_size - begin) ? size : ring_size - begin;
+	memcpy(ring + begin, data, first);
+	memcpy(ring, data + first, size - first);
+	head.store(h + size, std::memory_order_release);
+
+	records.fetch_add(1, std::memory_order_relaxed);
+	int queue_bytes = (int)(h + size - tail.load(std::memory_order_relaxed));
+	if (queue_bytes > max_queue_bytes.load(std::memory_order_relaxed))
+		max_queue_bytes.store(queue_bytes, std::memory_order_relaxed);
+	return true;
+}
+
+
+/*
+@brief	Wait until every queued record is written to the file
+*/
+void AsyncFileWriter::Flush()
+{
+	if (!running.load())
+		return;
+
+	uint64_t h = head.load(std::memory_order_acquire);
+	flush_request = true;
+	while (tail.load(std::memory_order_acquire) < h)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+
+/*
+@brief	Get the counters since the writer was created, while running or after Stop()
+*/
+void AsyncFileWriter::getStats(AsyncWriterStats* stats)
+{
+	stats->records = records.load(std::memory_order_relaxed);
+	stats->dropped = dropped.load(std::memory_order_relaxed);
+	stats->blocked = blocked.load(std::memory_order_relaxed);
+	stats->bytes = tail.load(std::memory_order_relaxed);
+	stats->blocks = blocks.load(std::memory_order_relaxed);
+	stats->queue_bytes = (int)(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed));
+	stats->max_queue_bytes = max_queue_bytes.load(std::memory_order_relaxed);
+	stats->mean_write_time = (stats->blocks > 0) ? 1e-9 * write_ns.load(std::memory_order_relaxed) / stats->blocks : 0;
+	stats->max_write_time = 1e-9 * max_write_ns.load(std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Writer thread : batch the queued records into block writes
+This is an internal function.
+*/
+void AsyncFileWriter::Run()
+{
+	Trace::setThreadName("file writer");
+
+	int64_t oldest_ns = 0;		// when records started waiting, 0 -> none waiting
+	while (running.load(std::memory_order_relaxed))
+	{
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		uint64_t h = head.load(std::memory_order_acquire);
+		if (h == t)
+		{
+			flush_request = false;
+			oldest_ns = 0;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		int64_t now_ns = NowNs();
+		if (oldest_ns == 0)
+			oldest_ns = now_ns;
+
+		if (h - t >= (uint64_t)block_size || now_ns - oldest_ns >= flush_interval_ns || flush_request.load())
+		{
+			WriteBlock(t, h);
+			oldest_ns = 0;
+		}
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+
+/*
+@brief	Write bytes [begin, end) of the ring to the file (2 writes if they wrap around) & free them
+This is an internal function.
+*/
+void AsyncFileWriter::WriteBlock(uint64_t begin, uint64_t end)
+{
+	TRACE_SCOPE_ARG("AsyncFileWriter::WriteBlock", end - begin);
+
+	int64_t begin_ns = NowNs();
+
+	int offset = (int)(begin & (ring_size - 1));
+	int size = (int)(end - begin);
+	int first = (size < ring_size - offset) ? size : ring_size - offset;
+	file->write(ring + offset, first);
+	if (size > first)
+		file->write(ring, size - first);
+	file->flush();
+
+	tail.store(end, std::memory_order_release);
+
+	uint64_t busy = (uint64_t)(NowNs() - begin_ns);
+	blocks.fetch_add(1, std::memory_order_relaxed);
+	write_ns.fetch_add(busy, std::memory_order_relaxed);
+	if (busy > max_write_ns.load(std::memory_order_relaxed))
+		max_write_ns.store(busy, std::memory_order_relaxed);
+}
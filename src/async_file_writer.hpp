@@ -0,0 +1,89 @@
+#ifndef ASYNC_FILE_WRITER_HPP
+#define ASYNC_FILE_WRITER_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+
+// What Write() does when the ring is full (the disk does not keep up)
+enum WritePolicy
+{
+	kWriteDrop,		// drop the record (counted) : the caller never waits, e.g. the control loop
+	kWriteBlock		// wait for the writer thread : no record is lost
+};
+
+
+// Counters of the writer, see AsyncFileWriter::getStats()
+struct AsyncWriterStats
+{
+	uint64_t records;		// records queued
+	uint64_t dropped;		// records dropped (kWriteDrop) because the ring was full
+	uint64_t blocked;		// records that waited for room (kWriteBlock)
+	uint64_t bytes;			// bytes written to the file
+	uint64_t blocks;		// block writes to the file
+	int queue_bytes;		// bytes waiting in the ring
+	int max_queue_bytes;	// max bytes waiting in the ring
+	double mean_write_time;	// mean time of a block write & flush (in seconds)
+	double max_write_time;	// max time of a block write & flush (in seconds)
+};
+
+
+/**
+* Writes records to a file on a background thread, so disk hiccups never reach the caller
+*
+* Write() only copies the record into a lock-free byte ring (one producer thread).
+* The writer thread batches everything queued into large block writes : when block_size bytes are waiting,
+* or flush_interval after the oldest record, whichever comes first.
+* Records are written whole and in order. The file must not be touched by the caller while running, except after Flush().
+*/
+class AsyncFileWriter
+{
+public:
+	static const int ring_size = 1 << 20;	// bytes (power of two)
+
+	AsyncFileWriter();
+	~AsyncFileWriter();
+
+	bool Start(std::ofstream* file, WritePolicy policy = kWriteDrop, int block_size = 64 * 1024, double flush_interval = 0.1);
+
+	void Stop();
+
+	bool Write(const char* data, int size);
+
+	void Flush();
+
+	bool isRunning() { return running.load(); }
+
+	void getStats(AsyncWriterStats* stats);
+
+private:
+	char* ring;
+	alignas(64) std::atomic<uint64_t> head;		// bytes queued so far, written by the caller
+	alignas(64) std::atomic<uint64_t> tail;		// bytes written so far, written by the writer thread
+	alignas(64) std::atomic<bool> flush_request;
+
+	std::ofstream* file = NULL;
+	WritePolicy policy = kWriteDrop;
+	int block_size = 64 * 1024;
+	int64_t flush_interval_ns = 100000000;
+
+	std::atomic<uint64_t> records;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> blocked;
+	std::atomic<uint64_t> blocks;
+	std::atomic<uint64_t> write_ns;
+	std::atomic<uint64_t> max_write_ns;
+	std::atomic<int> max_queue_bytes;
+
+	std::thread thread;
+	std::atomic<bool> running;
+
+	void Run();
+
+	void WriteBlock(uint64_t begin, uint64_t end);
+};
+
+
+#endif // ASYNC_FILE_WRITER_HPP
@@ -0,0 +1,247 @@
+#include "contact_bitboard.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CONTACT_BITBOARD_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+// Number of set bits of a 64-bit word
+static inline int PopCount64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(x);
+#else
+	int count = 0;
+	while (x)
+	{
+		x &= x - 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static inline ContactBitboard And(const ContactBitboard& a, const ContactBitboard& b)
+{
+	ContactBitboard r;
+	r.lo = a.lo & b.lo;
+	r.hi = a.hi & b.hi;
+	return r;
+}
+
+static inline ContactBitboard Or(const ContactBitboard& a, const ContactBitboard& b)
+{
+	ContactBitboard r;
+	r.lo = a.lo | b.lo;
+	r.hi = a.hi | b.hi;
+	return r;
+}
+
+// Shift towards higher bits, 0 < n < 64
+static inline ContactBitboard ShiftUp(const ContactBitboard& a, int n)
+{
+	ContactBitboard r;
+	r.hi = (a.hi << n) | (a.lo >> (64 - n));
+	r.lo = a.lo << n;
+	return r;
+}
+
+// Shift towards lower bits, 0 < n < 64
+static inline ContactBitboard ShiftDown(const ContactBitboard& a, int n)
+{
+	ContactBitboard r;
+	r.lo = (a.lo >> n) | (a.hi << (64 - n));
+	r.hi = a.hi >> n;
+	return r;
+}
+
+
+/** Constant masks of the 15x7 board, built once
+*/
+struct BoardMasks
+{
+	ContactBitboard full;		// all 105 pixels
+	ContactBitboard not_first;	// all pixels except column 0 (may move to col-1)
+	ContactBitboard not_last;	// all pixels except column 6 (may move to col+1)
+
+	BoardMasks()
+	{
+		for (int bit = 0; bit < ContactBitboard::n_cell; bit++)
+		{
+			uint64_t* word_full = (bit < 64) ? &full.lo : &full.hi;
+			uint64_t* word_first = (bit < 64) ? &not_first.lo : &not_first.hi;
+			uint64_t* word_last = (bit < 64) ? &not_last.lo : &not_last.hi;
+			uint64_t mask = uint64_t(1) << (bit % 64);
+			int col = bit % ContactBitboard::n_col;
+
+			*word_full |= mask;
+			if (col != 0)
+				*word_first |= mask;
+			if (col != ContactBitboard::n_col - 1)
+				*word_last |= mask;
+		}
+	}
+};
+
+static const BoardMasks& getBoardMasks()
+{
+	static const BoardMasks masks;
+	return masks;
+}
+
+
+/*
+@brief	Threshold all pixels of a RAW serial packet straight into a contact bitboard
+
+The packet holds 105x <uint16_t> little-endian, in row-major order (row * 7 + col).
+With SSE2, 16 pixels are compared per iteration: 2x _mm_cmpgt_epi16 (unsigned, via sign-bias),
+packed to bytes and turned into 16 bits with _mm_movemask_epi8. The last 9 pixels are done one by one.
+
+@param[in]	data		the 210 bytes of the serial packet
+@param[in]	threshold	pixel value above which the pixel is in contact (0..65535)
+
+@return	the contact bitboard
+*/
+ContactBitboard ContactBitboard::FromPacket(const unsigned char* data, int threshold)
+{
+	ContactBitboard board;
+	int cell = 0;
+
+#ifdef CONTACT_BITBOARD_SSE2
+	const __m128i bias = _mm_set1_epi16((short)0x8000);
+	const __m128i limit = _mm_set1_epi16((short)(threshold ^ 0x8000));
+
+	for (; cell + 16 <= n_cell; cell += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(data + 2 * cell));
+		__m128i b = _mm_loadu_si128((const __m128i*)(data + 2 * cell + 16));
+		a = _mm_cmpgt_epi16(_mm_xor_si128(a, bias), limit);
+		b = _mm_cmpgt_epi16(_mm_xor_si128(b, bias), limit);
+		uint64_t bits = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(a, b));
+
+		if (cell < 64)
+			board.lo |= bits << cell;
+		else
+			board.hi |= bits << (cell - 64);
+	}
+#endif
+
+	for (; cell < n_cell; cell++)
+	{
+		int value = (data[2 * cell + 1] << 8) | data[2 * cell];
+		if (value > threshold)
+		{
+			if (cell < 64)
+				board.lo |= uint64_t(1) << cell;
+			else
+				board.hi |= uint64_t(1) << (cell - 64);
+		}
+	}
+
+	return board;
+}
+
+
+bool ContactBitboard::get(int row, int col) const
+{
+	int bit = row * n_col + col;
+	if (bit < 64)
+		return (lo >> bit) & 1;
+	return (hi >> (bit - 64)) & 1;
+}
+
+
+/*
+@brief	Contact area, in number of pixels
+*/
+int ContactBitboard::Area() const
+{
+	return PopCount64(lo) + PopCount64(hi);
+}
+
+
+/*
+@brief	Keep only the lowest set bit (the first pixel in serial order)
+*/
+ContactBitboard ContactBitboard::LowestBit() const
+{
+	ContactBitboard r;
+	if (lo != 0)
+		r.lo = lo & (~lo + 1);
+	else
+		r.hi = hi & (~hi + 1);
+	return r;
+}
+
+
+/*
+@brief	Grow every set pixel into its 4 neighbours (up, down, left, right) without wrapping across columns
+*/
+ContactBitboard ContactBitboard::Dilate() const
+{
+	const BoardMasks& masks = getBoardMasks();
+
+	ContactBitboard r = *this;
+	r = Or(r, ShiftUp(And(*this, masks.not_last), 1));		// col + 1
+	r = Or(r, ShiftDown(And(*this, masks.not_first), 1));	// col - 1
+	r = Or(r, ShiftUp(*this, n_col));						// row + 1
+	r = Or(r, ShiftDown(*this, n_col));						// row - 1
+	return And(r, masks.full);
+}
+
+
+/*
+@brief	Grow the seed inside this mask until it covers the whole connected blob (4-connectivity)
+
+@param[in]	seed	pixel(s) to start from, must be inside this mask
+
+@return	the connected blob that contains the seed
+*/
+ContactBitboard ContactBitboard::FloodFill(const ContactBitboard& seed) const
+{
+	ContactBitboard blob = And(seed, *this);
+	while (true)
+	{
+		ContactBitboard grown = And(blob.Dilate(), *this);
+		if (grown == blob)
+			return blob;
+		blob = grown;
+	}
+}
+
+
+/*
+@brief	Split the contact mask into connected blobs
+
+Blobs are found in serial order of their first pixel (row 0 first).
+
+@param[out]	blobs		array to store the first max_blob blobs
+@param[in]	max_blob	size of blobs[]
+
+@return	the total number of blobs (may be more than max_blob)
+*/
+int ContactBitboard::Segment(ContactBitboard* blobs, int max_blob) const
+{
+	ContactBitboard remaining = *this;
+	int num_blob = 0;
+
+	while (!remaining.isEmpty())
+	{
+		ContactBitboard blob = remaining.FloodFill(remaining.LowestBit());
+		if (num_blob < max_blob)
+			blobs[num_blob] = blob;
+		num_blob++;
+
+		remaining.lo &= ~blob.lo;
+		remaining.hi &= ~blob.hi;
+	}
+
+	return num_blob;
+}
@@ -0,0 +1,45 @@
+#ifndef CONTACT_BITBOARD_HPP
+#define CONTACT_BITBOARD_HPP
+
+#include <stdint.h>
+
+
+/**
+* Contact mask of one foot-sensor as a 128-bit word
+*
+* Bit (row * 7 + col) is set when the pixel is above the contact threshold,
+* i.e. the same order as the pixels arrive in the serial packet.
+* Only bits 0..104 are used, lo holds bits 0..63 and hi holds bits 64..127.
+*
+* Contact area is a popcount, and connected blobs (e.g. heel and forefoot contacts)
+* are found with a bit-parallel flood fill: every iteration grows ALL pixels of the blob at once.
+*/
+struct ContactBitboard
+{
+	static const int n_row = 15;
+	static const int n_col = 7;
+	static const int n_cell = n_row * n_col;
+
+	uint64_t lo = 0;
+	uint64_t hi = 0;
+
+	static ContactBitboard FromPacket(const unsigned char* data, int threshold);
+
+	bool get(int row, int col) const;
+	bool isEmpty() const { return (lo | hi) == 0; }
+	bool operator==(const ContactBitboard& other) const { return lo == other.lo && hi == other.hi; }
+	bool operator!=(const ContactBitboard& other) const { return !(*this == other); }
+
+	int Area() const;
+
+	ContactBitboard LowestBit() const;
+
+	ContactBitboard Dilate() const;
+
+	ContactBitboard FloodFill(const ContactBitboard& seed) const;
+
+	int Segment(ContactBitboard* blobs, int max_blob) const;
+};
+
+
+#endif // CONTACT_BITBOARD_HPP
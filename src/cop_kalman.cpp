@@ -0,0 +1,132 @@
+#include "cop_kalman.hpp"
+
+
+/*
+@brief	Set the noise model and the smoother lag, and stop tracking
+
+@param[in]	jerk_noise			spectral density of the white jerk (pixels^2 / s^5), larger -> more responsive
+@param[in]	measurement_noise	variance of the raw COP (pixels^2), larger -> smoother
+@param[in]	lag					fixed lag of the smoother in frames (0 -> no smoothing, max max_lag)
+*/
+void COPKalman::Init(float jerk_noise, float measurement_noise, int lag)
+{
+	this->jerk_noise = jerk_noise;
+	this->measurement_noise = measurement_noise;
+	this->lag = (lag < 0) ? 0 : ((lag > max_lag) ? max_lag : lag);
+
+	tracking = false;
+	count = 0;
+	head = 0;
+	state.setZero();
+	P.setIdentity();
+}
+
+
+/*
+@brief	Predict with the real time interval, then correct with the measured COP
+
+The filter (re)starts at the first valid COP of each contact, at rest.
+Frames without contact (valid == false) stop the tracking, because the COP is undefined during swing.
+
+@param[in]	cop_x		raw x-coordinate of the COP (from CalcCOP)
+@param[in]	cop_y		raw y-coordinate of the COP
+@param[in]	valid		false when the foot is unloaded
+@param[in]	time_stamp	time-stamp of the frame (in seconds)
+*/
+void COPKalman::Update(float cop_x, float cop_y, bool valid, double time_stamp)
+{
+	if (!valid)
+	{
+		tracking = false;
+		count = 0;
+		return;
+	}
+
+	Eigen::Matrix<float, 1, 2> z(cop_x, cop_y);
+	Matrix3 F = Matrix3::Identity();
+
+	if (!tracking)
+	{
+		state.setZero();
+		state.row(0) = z;
+		P.setZero();
+		P(0, 0) = measurement_noise;
+		P(1, 1) = 100;		// velocity unknown (pixels / s)^2
+		P(2, 2) = 10000;	// acceleration unknown (pixels / s^2)^2
+		tracking = true;
+	}
+	else
+	{
+		float dt = float(time_stamp - time_stamp_prev);
+		if (dt <= 0)
+			dt = 1e-3f;
+		float dt2 = dt * dt, dt3 = dt2 * dt;
+
+		F(0, 1) = dt;
+		F(0, 2) = 0.5f * dt2;
+		F(1, 2) = dt;
+
+		// Discrete white-jerk process noise
+		Matrix3 Q;
+		Q << dt3 * dt2 / 20, dt2 * dt2 / 8, dt3 / 6,
+			dt2 * dt2 / 8, dt3 / 3, dt2 / 2,
+			dt3 / 6, dt2 / 2, dt;
+		Q *= jerk_noise;
+
+		state = F * state;
+		P = F * P * F.transpose() + Q;
+	}
+	time_stamp_prev = time_stamp;
+
+	// Store the prediction for the smoother
+	head = (head + 1) % (max_lag + 1);
+	Step& step = history[head];
+	step.F = F;
+	step.x_pred = state;
+	step.P_pred = P;
+	step.time_stamp = time_stamp;
+
+	// Correction, H = [1 0 0] for both axes
+	float S = P(0, 0) + measurement_noise;
+	Eigen::Vector3f K = P.col(0) / S;
+	Eigen::Matrix<float, 1, 2> innovation = z - state.row(0);
+	state += K * innovation;
+	P -= K * P.row(0);
+
+	step.x_filt = state;
+	step.P_filt = P;
+	if (count < max_lag + 1)
+		count++;
+}
+
+
+/*
+@brief	Fixed-lag smoothed COP, "lag" frames behind the newest frame (RTS backward pass over the lag window)
+
+@param[out]	smoothed	smoothed [pos, vel, acc] of both axes
+@param[out]	time_stamp	time-stamp of the smoothed frame
+
+@return	false if fewer than lag+1 frames were tracked in the current contact
+*/
+bool COPKalman::getSmoothed(State* smoothed, double* time_stamp)
+{
+	if (!tracking || count < lag + 1)
+		return false;
+
+	State x_smooth = history[head].x_filt;
+	int k_next = head;
+	for (int i = 0; i < lag; i++)
+	{
+		int k = (k_next + max_lag) % (max_lag + 1);
+		const Step& next = history[k_next];
+		const Step& curr = history[k];
+
+		Matrix3 C = curr.P_filt * next.F.transpose() * next.P_pred.inverse();
+		x_smooth = curr.x_filt + C * (x_smooth - next.x_pred);
+		k_next = k;
+	}
+
+	*smoothed = x_smooth;
+	*time_stamp = history[k_next].time_stamp;
+	return true;
+}
@@ -0,0 +1,67 @@
+#ifndef COP_KALMAN_HPP
+#define COP_KALMAN_HPP
+
+#include "Eigen/Dense"
+
+
+/**
+* Constant-acceleration Kalman filter of the COP trajectory of one foot
+*
+* State per axis = [position, velocity, acceleration], driven by white jerk noise.
+* Both axes share the same model (F, Q, H, R), hence the same covariance & gain:
+* one [3x3] covariance and a [3x2] state matrix (column 0 -> cop_x ; column 1 -> cop_y).
+* The true time interval between frames is used in every prediction.
+*
+* A fixed-lag Rauch-Tung-Striebel smoother runs over the last "lag" frames,
+* giving a smoothed COP delayed by "lag" frames (for logging, not for control).
+*
+* All matrices are fixed-size, so one update is a few hundred flops without allocation.
+*/
+class COPKalman
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	static const int max_lag = 16;
+
+	typedef Eigen::Matrix3f Matrix3;
+	typedef Eigen::Matrix<float, 3, 2> State;	// [pos, vel, acc] x [cop_x, cop_y]
+
+	void Init(float jerk_noise, float measurement_noise, int lag);
+
+	void Update(float cop_x, float cop_y, bool valid, double time_stamp);
+
+	bool isTracking() { return tracking; }
+
+	const State& getState() { return state; }
+
+	bool getSmoothed(State* smoothed, double* time_stamp);
+
+private:
+	struct Step
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+		Matrix3 F;			// transition INTO this step
+		Matrix3 P_pred;
+		Matrix3 P_filt;
+		State x_pred;
+		State x_filt;
+		double time_stamp;
+	};
+
+	float jerk_noise = 1000;			// pixels^2 / s^5, spectral density of the white jerk
+	float measurement_noise = 0.05f;	// pixels^2, variance of the raw COP
+	int lag = 0;
+
+	bool tracking = false;
+	State state;
+	Matrix3 P;
+	double time_stamp_prev = 0;
+
+	Step history[max_lag + 1];
+	int head = 0;		// index of the newest step
+	int count = 0;		// valid steps in history
+};
+
+
+#endif // COP_KALMAN_HPP
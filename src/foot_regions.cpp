@@ -0,0 +1,122 @@
+#include "foot_regions.hpp"
+
+
+FootRegions::FootRegions()
+{
+	Init(false, true);
+}
+
+
+/*
+@brief	Label every pixel of both feet with the default anatomical geometry
+
+@param[in]	heel_at_first_row			true -> row 0 is under the heel ; false -> row 0 is under the toes
+@param[in]	right_medial_at_first_col	true -> column 0 of the RIGHT sensor is on the medial (big-toe) side
+*/
+void FootRegions::Init(bool heel_at_first_row, bool right_medial_at_first_col)
+{
+	this->heel_at_first_row = heel_at_first_row;
+
+	for (int foot = 0; foot < 2; foot++)
+	{
+		// The left foot is mirrored : its medial side is on the opposite column
+		bool medial_first = (foot == 1) ? right_medial_at_first_col : !right_medial_at_first_col;
+
+		for (int row = 0; row < n_row; row++)
+		{
+			int toe_row = heel_at_first_row ? (n_row - 1 - row) : row;	// 0 -> toes ; 14 -> heel
+
+			for (int col = 0; col < n_col; col++)
+			{
+				int medial_col = medial_first ? col : (n_col - 1 - col);	// 0 -> medial ; 6 -> lateral
+				bool medial = (medial_col < 3);
+
+				FootRegion region;
+				if (toe_row < 3)
+					region = medial ? kRegionHallux : kRegionLesserToes;
+				else if (toe_row < 6)
+					region = kRegionMetatarsal;
+				else if (toe_row < 10)
+					region = medial ? kRegionMedialMidfoot : kRegionLateralMidfoot;
+				else
+					region = kRegionHeel;
+
+				label[foot][col * n_row + row] = (unsigned char)region;
+			}
+		}
+	}
+}
+
+
+/*
+@brief	Override the region of a single pixel (custom insole geometry)
+
+@param[in]	foot	0 -> left ; 1 -> right
+@param[in]	row		row of the pixel (0..14)
+@param[in]	col		column of the pixel (0..6)
+@param[in]	region	new region of the pixel
+*/
+void FootRegions::setRegion(int foot, int row, int col, FootRegion region)
+{
+	label[foot][col * n_row + row] = (unsigned char)region;
+}
+
+
+FootRegion FootRegions::getRegion(int foot, int row, int col)
+{
+	return (FootRegion)label[foot][col * n_row + row];
+}
+
+
+/*
+@brief	Calculate the total pressure-sum, COP and all regional loads of one foot in a single pass
+
+The moments are accumulated as integers, so the whole-foot COP is identical to the matrix-product version.
+
+@param[in]	foot				0 -> left ; 1 -> right
+@param[in]	cells				105 pixels in column-major order (Eigen::MatrixXi::data())
+@param[in]	contact_threshold	pixel value above which the pixel is counted as loaded
+@param[out]	total				pressure-sum of the whole foot
+@param[out]	cop_x				x-coordinate of the COP (along the rows)
+@param[out]	cop_y				y-coordinate of the COP (along the columns)
+@param[out]	regional			pressure-sum, COP and loaded pixels of every region
+*/
+void FootRegions::Calc(int foot, const int* cells, int contact_threshold, float* total, float* cop_x, float* cop_y, RegionalLoad* regional)
+{
+	int sum[kNumRegion] = { 0 };
+	int moment_x[kNumRegion] = { 0 };
+	int moment_y[kNumRegion] = { 0 };
+	int active[kNumRegion] = { 0 };
+
+	const unsigned char* region = label[foot];
+	int cell = 0;
+	for (int col = 1; col <= n_col; col++)
+	{
+		for (int row = 1; row <= n_row; row++, cell++)
+		{
+			int value = cells[cell];
+			int r = region[cell];
+			sum[r] += value;
+			moment_x[r] += value * row;
+			moment_y[r] += value * col;
+			active[r] += (value > contact_threshold);
+		}
+	}
+
+	int total_sum = 0, total_x = 0, total_y = 0;
+	for (int r = 0; r < kNumRegion; r++)
+	{
+		total_sum += sum[r];
+		total_x += moment_x[r];
+		total_y += moment_y[r];
+
+		regional->load[r] = sum[r];
+		regional->cop_x[r] = (sum[r] == 0) ? 0 : float(moment_x[r]) / sum[r];
+		regional->cop_y[r] = (sum[r] == 0) ? 0 : float(moment_y[r]) / sum[r];
+		regional->active_cells[r] = active[r];
+	}
+
+	*total = total_sum;
+	*cop_x = (total_sum == 0) ? 0 : float(total_x) / total_sum;
+	*cop_y = (total_sum == 0) ? 0 : float(total_y) / total_sum;
+}
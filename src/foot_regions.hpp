@@ -0,0 +1,71 @@
+#ifndef FOOT_REGIONS_HPP
+#define FOOT_REGIONS_HPP
+
+
+/** Anatomical regions of the insole
+*/
+enum FootRegion
+{
+	kRegionHeel = 0,
+	kRegionLateralMidfoot = 1,
+	kRegionMedialMidfoot = 2,
+	kRegionMetatarsal = 3,		// metatarsal heads
+	kRegionHallux = 4,
+	kRegionLesserToes = 5,
+	kNumRegion = 6
+};
+
+/** Pressure-sum, COP and number of loaded pixels of every region of one foot
+*
+* COP is in pixels, same convention as PressureData : x along the 15 rows, y along the 7 columns (both 1-based).
+*/
+struct RegionalLoad
+{
+	float load[kNumRegion] = { 0 };
+	float cop_x[kNumRegion] = { 0 };
+	float cop_y[kNumRegion] = { 0 };
+	int active_cells[kNumRegion] = { 0 };	// pixels above the contact threshold
+};
+
+
+/**
+* Precomputed region masks of both foot-sensors
+*
+* Each pixel is labelled with one FootRegion, once per geometry.
+* Calc() then produces the total pressure-sum, the COP AND every regional load & COP
+* in a single pass over the 105 pixels, instead of one pass per region.
+*
+* Default geometry (row 0 under the toes, 15 rows x 7 cols):
+* rows 0-2		-> hallux (3 medial cols) & lesser toes (4 lateral cols)
+* rows 3-5		-> metatarsal heads
+* rows 6-9		-> medial midfoot (3 medial cols) & lateral midfoot (4 lateral cols)
+* rows 10-14	-> heel
+* The left foot is the mirror image (in columns) of the right foot.
+*/
+class FootRegions
+{
+public:
+	static const int n_row = 15;
+	static const int n_col = 7;
+	static const int n_cell = n_row * n_col;
+
+	FootRegions();
+
+	void Init(bool heel_at_first_row, bool right_medial_at_first_col);
+
+	void setRegion(int foot, int row, int col, FootRegion region);
+
+	FootRegion getRegion(int foot, int row, int col);
+
+	void Calc(int foot, const int* cells, int contact_threshold, float* total, float* cop_x, float* cop_y, RegionalLoad* regional);
+
+	bool isHeelAtFirstRow() { return heel_at_first_row; }
+
+private:
+	// label[foot][cell] with foot : 0 -> left ; 1 -> right ; cell in column-major order (same as Eigen::MatrixXi::data())
+	unsigned char label[2][n_cell];
+	bool heel_at_first_row = false;
+};
+
+
+#endif // FOOT_REGIONS_HPP
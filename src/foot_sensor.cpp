@@ -1,4 +1,11 @@
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #include "foot_sensor.hpp"
+#include "trace.hpp"
 
 
 using namespace std;
@@ -17,43 +24,61 @@ In Windows, left-sensor -> COM13 ; right-sensor -> COM7
 void FootSensor::OpenSerialPort(USBStream* serial_port)
 {
 	// Define the serial port number
-	std::string* comport = new std::string[2];
 #if defined(_WIN32) || defined(_WIN32)
-	comport[0] = "13";		// User to define COM port of left foot
-	comport[1] = "7";		// User to define COM port of right foot
+	const char* comport_left = "13";		// User to define COM port of left foot
+	const char* comport_right = "7";		// User to define COM port of right foot
 #elif defined (__unix__)
-	comport[0] = "0";		// User to define COM port of left foot_sensor
-	comport[1] = "1";		// User to define COM port of right foot_sensor
+	const char* comport_left = "0";		// User to define COM port of left foot_sensor
+	const char* comport_right = "1";		// User to define COM port of right foot_sensor
 #endif
 
+	if (!OpenSerialPort(serial_port, comport_left, comport_right))
+		exit(1);
+}
+
+
+/*
+@brief	Open the serial ports of one insole pair, given their names (e.g. one pair per subject of a SessionManager)
+
+@param[in]	serial_port		2 serial ports : [0] -> left ; [1] -> right
+@param[in]	comport_left	name of the serial port of the left foot-sensor
+@param[in]	comport_right	name of the serial port of the right foot-sensor
+@return	false if a port could not be opened
+*/
+bool FootSensor::OpenSerialPort(USBStream* serial_port, const char* comport_left, const char* comport_right)
+{
+	const char* comport[2] = { comport_left, comport_right };
+
     const int USB_num = 2;
 
 	for (int k = 0; k < USB_num; k++)
 	{
 		// Declare the configuration of serial port
 #if defined(_WIN32) || defined(WIN32)
-		serial_port_CoP[k].configurePort(115200, 8, 0, 0, 0);
+		serial_port[k].configurePort(115200, 8, 0, 0, 0);
 #elif defined(__unix__)
 		serial_port[k].configurePort(115200, 8, 0, 1, 0);
 #endif
 		// Open serial port  &  Set configuration  &  Set wait-comm-event
-		serial_port[k].Open(comport[k].c_str());
+		serial_port[k].Open(comport[k]);
 		// Print out the status of opening serial port
 		if (!serial_port[k].good())
 		{
 			std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] "
-					<< "Error: Could not open serial port: " << comport[k].c_str()
+					<< "Error: Could not open serial port: " << comport[k]
 					<< std::endl;
-			exit(1);
+			return false;
 		}
 		else
-			std::cout << "Successfully open serial port: " << comport[k].c_str() << std::endl;
+			std::cout << "Successfully open serial port: " << comport[k] << std::endl;
 			// Set time-outs
 
 #if defined(_WIN32) || defined(WIN32)
-		serial_port_CoP[k].setTimeouts(0.005, 1, 0.01, 0.1, 0.1);
+		serial_port[k].setTimeouts(0.005, 1, 0.01, 0.1, 0.1);
 #endif
 	}
+
+	return true;
 }
 
 
@@ -73,11 +98,35 @@ Third store the 1D array into 2D Eigen matrix
 */
 void FootSensor::ReadPressureData(USBStream* serial_port, PressureData* pressure_data)
 {
+	TRACE_SCOPE("FootSensor::ReadPressureData");
+
+	ReadPressurePacket(serial_port, &read_packet);
+	DecodePressureData(&read_packet, pressure_data);
+}
+
+
+/*
+@brief	Read the RAW packets of both foot sensors, without decoding them (acquisition part of ReadPressureData())
+Log the time-stamp & sequence number of this sensor reading
+
+Each read gives up after the read time-out (see setReadTimeout() ; on Windows, the time-outs set by OpenSerialPort()),
+so a foot-sensor that does not answer (e.g. unplugged) never blocks the caller.
+
+@param[in]	serial_port	object to handle the serial Communication
+@param[out]	packet		RAW packets of both feet
+@return	false if a foot-sensor did not send its whole packet in time (the packet is still time-stamped & numbered)
+*/
+bool FootSensor::ReadPressurePacket(USBStream* serial_port, PressurePacket* packet)
+{
+	TRACE_SCOPE("FootSensor::ReadPressurePacket");
+
     bool read_success = false;
-	unsigned char *data = new unsigned char[210]; // To store 105x <uint16_t> data from STM32
+	bool complete = true;
 
 	for (int k = 0; k < 2; k++) // Start reading the serial port 1-by-1
 	{
+		TRACE_SCOPE_ARG("FootSensor::ReadPort", k);	// which port was slow
+
 		while (read_success == false)
 		{
 			// Send command to start the Arduino Communication
@@ -88,30 +137,8 @@ void FootSensor::ReadPressureData(USBStream* serial_port, PressureData* pressure
 			// Skip the matching step of the returned Serial_Command, proceed to read (2x)105 bytes of pressure sensor
 			if (true) 
 			{
-				serial_port[k].read((char *)data, 210);
-
-				// Convert the data from   uint16_t >> uint8_t >> int   and store in matrix [15 x 7]
-				for (int i = 0; i < 210; i++)
-				{
-					int cur_row = (i / 2) / 7;
-					int cur_col = (i / 2) % 7;
-					if (k == 0)
-					{
-						if ((i % 2) == 1)
-						{
-							uint16_t temp_holder = (data[i] << 8) | data[i - 1];
-							pressure_data->sensor_left(cur_row, cur_col) = int(static_cast<uint16_t>(temp_holder));
-						}
-					}
-					else
-					{
-						if ((i % 2) == 1)
-						{
-							uint16_t temp_holder = (data[i] << 8) | data[i - 1];
-							pressure_data->sensor_right(cur_row, cur_col) = int(static_cast<uint16_t>(temp_holder));
-						}
-					}
-				}
+				if (serial_port[k].read((char *)packet->data[k], 210, read_timeout) < 210)
+					complete = false;
 				read_success = true;
 			}
 		}
@@ -123,17 +150,140 @@ void FootSensor::ReadPressureData(USBStream* serial_port, PressureData* pressure
 	time_point_curr = std::chrono::steady_clock::now();
     time_interval = time_point_curr - time_point_prev;
 	time_point_prev = std::chrono::steady_clock::now();
+	packet->time_stamp = std::chrono::duration<double>(time_point_curr - time_point_start).count();
+	packet->seq = ++frame_count;
+	return complete;
+}
+
+
+/*
+@brief	Decode the RAW packets of both foot sensors into pressure_data (decoding part of ReadPressureData())
+Convert the data from   uint16_t >> uint8_t >> int   and store in matrix [15 x 7] & contact bitboard
+
+Unchanged pixels are only kept when pressure_data holds the previously decoded frame,
+so packets can be decoded into any frame buffer (e.g. of a Pipeline).
 
-	delete[] data;
+@param[in]	packet			RAW packets of both feet, from ReadPressurePacket()
+@param[out]	pressure_data	struct that contains 2 Eigen matrices [15x7] to store pressure @ pixels
+*/
+void FootSensor::DecodePressureData(const PressurePacket* packet, PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::DecodePressureData");
+
+	// pressure_data still holds the previous frame, so unchanged pixels can be kept as they are
+	bool cached = (pressure_data->frame_seq > 0) && (pressure_data->frame_seq + 1 == packet->seq);
+
+	DecodePressurePacket(0, packet->data[0], cached, &(pressure_data->sensor_left), &(pressure_data->left_contact),
+		&(pressure_data->left_changed), &(pressure_data->left_all_zero));
+	DecodePressurePacket(1, packet->data[1], cached, &(pressure_data->sensor_right), &(pressure_data->right_contact),
+		&(pressure_data->right_changed), &(pressure_data->right_all_zero));
+
+	pressure_data->time_stamp = packet->time_stamp;
+	pressure_data->frame_seq = packet->seq;
 }
 
 
-/**/
+/*
+@brief	Compare a packet with the previous packet of the same foot, and check whether it is all zeros
+This is an internal function, not used in main().
+With SSE2, 16 bytes are compared per instruction.
+
+@param[in]	data		the new packet
+@param[in]	prev		the previous packet
+@param[out]	same		true if both packets are bit-identical
+@param[out]	all_zero	true if the new packet is all zeros
+*/
+static void ComparePacket(const unsigned char* data, const unsigned char* prev, int len, bool* same, bool* all_zero)
+{
+	int i = 0;
+	unsigned char diff = 0;
+	unsigned char bits = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	__m128i acc_diff = _mm_setzero_si128();
+	__m128i acc_bits = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+		acc_diff = _mm_or_si128(acc_diff, _mm_xor_si128(a, b));
+		acc_bits = _mm_or_si128(acc_bits, a);
+	}
+	__m128i zero = _mm_setzero_si128();
+	diff = (_mm_movemask_epi8(_mm_cmpeq_epi8(acc_diff, zero)) != 0xFFFF);
+	bits = (_mm_movemask_epi8(_mm_cmpeq_epi8(acc_bits, zero)) != 0xFFFF);
+#endif
+
+	for (; i < len; i++)
+	{
+		diff |= data[i] ^ prev[i];
+		bits |= data[i];
+	}
+
+	*same = (diff == 0);
+	*all_zero = (bits == 0);
+}
+
+
+/*
+@brief	Convert one serial packet into the pixel matrix and the contact bitboard
+This is an internal function, not used in main().
+
+The packet is first compared with the previous packet of the same foot (SIMD):
+a bit-identical packet is not decoded again, and an all-zero packet is cleared without decoding.
+The contact mask is thresholded with SIMD compares straight on the packet (see ContactBitboard::FromPacket).
+
+@param[in]	foot			0 -> left ; 1 -> right
+@param[in]	data			210 bytes = 105x <uint16_t> little-endian, row-major
+@param[in]	cached			true if pressure_mat & contact still hold the previous frame of this foot
+@param[out]	pressure_mat	the matrix [15x7] to store pixel-pressure
+@param[out]	contact			pixels above contact_threshold
+@param[out]	changed			false if the pixels are identical to the previous frame
+@param[out]	all_zero		true if all pixels are zero
+*/
+void FootSensor::DecodePressurePacket(int foot, const unsigned char* data, bool cached, Eigen::MatrixXi* pressure_mat, ContactBitboard* contact, bool* changed, bool* all_zero)
+{
+	bool same;
+	ComparePacket(data, last_packet[foot], 210, &same, all_zero);
+
+	*changed = !(same && cached);
+	if (!*changed)
+		return;
+	memcpy(last_packet[foot], data, 210);
+
+	if (*all_zero)
+	{
+		pressure_mat->setZero();
+		*contact = ContactBitboard();
+		return;
+	}
+
+	for (int i = 1; i < 210; i += 2)
+	{
+		int cur_row = (i / 2) / 7;
+		int cur_col = (i / 2) % 7;
+		uint16_t temp_holder = (data[i] << 8) | data[i - 1];
+		(*pressure_mat)(cur_row, cur_col) = int(static_cast<uint16_t>(temp_holder));
+	}
+
+	*contact = ContactBitboard::FromPacket(data, contact_threshold);
+}
+
+
+/*
+@brief	Calculate the gradiant of the RAW pressure-sum of both feet
+The gradiant is a Savitzky-Golay derivative over the last frames (see StreamingDerivative),
+using the real time-stamps of the frames, instead of a noisy two-point difference.
+
+@param[in/out]	pressure_data	struct that contains the pressure-sum & time-stamp as input and pressure gradiant as output
+*/
 void FootSensor::CalcPressureGradiant(PressureData* pressure_data)
 {
+	TRACE_SCOPE("FootSensor::CalcPressureGradiant");
+
 	// Calculate pressure gradiant from the RAW sensor reading
-    pressure_data->right_pressure_grad = (pressure_data->right_pressure - pressure_data->right_pressure_prev) / time_interval.count();
-    pressure_data->left_pressure_grad = (pressure_data->left_pressure - pressure_data->left_pressure_prev) / time_interval.count();
+	pressure_data->right_pressure_grad = pressure_deriv[1].Update(pressure_data->right_pressure, pressure_data->time_stamp);
+	pressure_data->left_pressure_grad = pressure_deriv[0].Update(pressure_data->left_pressure, pressure_data->time_stamp);
 
 	// Save the current reading as previous data, after calculating
 	pressure_data->right_pressure_prev = pressure_data->right_pressure;
@@ -141,16 +291,19 @@ void FootSensor::CalcPressureGradiant(PressureData* pressure_data)
 }
 
 
-/**/
+/*
+@brief	Calculate the gradiant of the AVERAGE pressure-sum of both feet
+Same Savitzky-Golay derivative as CalcPressureGradiant(), on its own ring of samples.
+
+@param[in/out]	pressure_data	struct that contains the average pressure-sum & time-stamp as input and its gradiant as output
+*/
 void FootSensor::CalcPressureAverGrad(PressureData* pressure_data)
 {
-	// Get the current time_point to calculate time_interval
-    time_point_curr = std::chrono::steady_clock::now();
-    time_interval = time_point_curr - time_point_prev;
+	TRACE_SCOPE("FootSensor::CalcPressureAverGrad");
 
 	// Calculate pressure gradiant from the AVERAGE sensor reading
-	pressure_data->right_pressure_aver_grad = (pressure_data->right_pressure_average - pressure_data->right_pressure_aver_prev) / time_interval.count();
-	pressure_data->left_pressure_aver_grad = (pressure_data->left_pressure_average - pressure_data->left_pressure_aver_prev) / time_interval.count();
+	pressure_data->right_pressure_aver_grad = pressure_aver_deriv[1].Update(pressure_data->right_pressure_average, pressure_data->time_stamp);
+	pressure_data->left_pressure_aver_grad = pressure_aver_deriv[0].Update(pressure_data->left_pressure_average, pressure_data->time_stamp);
 
 	// Save previous data with the RAW average_pressure
 	pressure_data->right_pressure_aver_prev = pressure_data->right_pressure_average;
@@ -159,58 +312,230 @@ void FootSensor::CalcPressureAverGrad(PressureData* pressure_data)
 
 
 /*
-@brief	Calculate the CoP of a single sensor, either left or right
+@brief	Calculate the CoP of a single FILTERED sensor, either left or right
 This is an internal function, not used in main().
 
-@param[in]	pressure_mat	the matrix that contains 99 pixel-pressure
+@param[in]	pressure_mat	the matrix that contains 99 filtered pixel-pressure
 @param[out]	cop_x			the x-coordinate of the COP
 @param[out]	cop_y			the y-coordinate of the COP
 
 @return	nothing
 */
-void FootSensor::CalcCOP_SingleSensor(Eigen::MatrixXi *pressure_mat, float *cop_x, float *cop_y)
+void FootSensor::CalcCOP_SingleSensor(Eigen::MatrixXf *pressure_mat, float *cop_x, float *cop_y)
 {
 	float pressure_sum = pressure_mat->sum();
 
-	Eigen::MatrixXi multiplier_colY(7, 1);
-	multiplier_colY << 1, 2, 3, 4, 5, 6, 7;
-
 	if (pressure_sum == 0)
 	{
+		*cop_x = 0;
 		*cop_y = 0;
+		return;
 	}
-	else
+
+	// Weights 1..7 along the columns and 1..15 along the rows, same as FootRegions::Calc()
+	*cop_y = (pressure_mat->colwise().sum().array() * Eigen::Array<float, 1, 7>::LinSpaced(7, 1, 7)).sum() / pressure_sum;
+	*cop_x = (pressure_mat->rowwise().sum().array() * Eigen::Array<float, 15, 1>::LinSpaced(15, 1, 15)).sum() / pressure_sum;
+}
+
+
+/*
+@brief	Calculate pressure-sum, COP and all regional loads of each foot-sensor, then save the results
+Every region (heel, midfoot, metatarsal heads, toes) is accumulated in the SAME pass as the whole-foot sum & COP.
+A foot whose pixels did not change since the previous frame keeps its previous results ; an all-zero foot is short-circuited.
+
+@param[in/out]	pressure_data	struct that contains pressure-pixels as input and pressure-sum, COP-x/y & regional loads as output
+
+@return nothing
+*/
+void FootSensor::CalcCOP(PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::CalcCOP");
+
+	Eigen::MatrixXi* sensor[2] = { &(pressure_data->sensor_left), &(pressure_data->sensor_right) };
+	bool changed[2] = { pressure_data->left_changed, pressure_data->right_changed };
+	bool all_zero[2] = { pressure_data->left_all_zero, pressure_data->right_all_zero };
+	float* pressure[2] = { &(pressure_data->left_pressure), &(pressure_data->right_pressure) };
+	float* cop_x[2] = { &(pressure_data->left_cop_x), &(pressure_data->right_cop_x) };
+	float* cop_y[2] = { &(pressure_data->left_cop_y), &(pressure_data->right_cop_y) };
+	RegionalLoad* regional[2] = { &(pressure_data->left_regions), &(pressure_data->right_regions) };
+
+	for (int k = 1; k >= 0; k--)
 	{
-		*cop_y = ((*pressure_mat) * (multiplier_colY)).sum() / pressure_sum;
+		// Unchanged pixels -> results of the previous frame are still valid
+		if (!changed[k])
+			continue;
+
+		if (all_zero[k])
+		{
+			*pressure[k] = 0;
+			*cop_x[k] = 0;
+			*cop_y[k] = 0;
+			*regional[k] = RegionalLoad();
+			continue;
+		}
+
+		foot_regions.Calc(k, sensor[k]->data(), contact_threshold, pressure[k], cop_x[k], cop_y[k], regional[k]);
 	}
+}
 
-	Eigen::MatrixXi multiplier_rowX(15, 1);
-	multiplier_rowX << 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15;
-	if (pressure_sum == 0)
+
+/*
+@brief	Configure the constant-acceleration Kalman filter of the COP of both feet
+
+@param[in]	jerk_noise			spectral density of the white jerk (pixels^2 / s^5), larger -> more responsive
+@param[in]	measurement_noise	variance of the raw COP (pixels^2), larger -> smoother
+@param[in]	lag					frames of delay of the smoothed COP for logging (0 -> no smoothing) [default=0]
+*/
+void FootSensor::InitCOPKalman(float jerk_noise, float measurement_noise, int lag)
+{
+	cop_kalman[0].Init(jerk_noise, measurement_noise, lag);
+	cop_kalman[1].Init(jerk_noise, measurement_noise, lag);
+}
+
+
+/*
+@brief	Filter the COP of both feet & estimate its velocity and acceleration, with the real frame interval.
+Tracking restarts at each new contact, and all outputs are 0 while the foot is unloaded.
+Call once per frame, after CalcCOP().
+
+@param[in/out]	pressure_data	struct that contains the RAW COP & time-stamp as input and filtered COP, velocity & acceleration as output
+
+@return nothing
+*/
+void FootSensor::CalcCOPKalman(PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::CalcCOPKalman");
+
+	float pressure[2] = { pressure_data->left_pressure, pressure_data->right_pressure };
+	float cop_x[2] = { pressure_data->left_cop_x, pressure_data->right_cop_x };
+	float cop_y[2] = { pressure_data->left_cop_y, pressure_data->right_cop_y };
+	float* output[2][6] = {
+		{ &(pressure_data->left_cop_x_kf), &(pressure_data->left_cop_y_kf), &(pressure_data->left_cop_vx),
+		  &(pressure_data->left_cop_vy), &(pressure_data->left_cop_ax), &(pressure_data->left_cop_ay) },
+		{ &(pressure_data->right_cop_x_kf), &(pressure_data->right_cop_y_kf), &(pressure_data->right_cop_vx),
+		  &(pressure_data->right_cop_vy), &(pressure_data->right_cop_ax), &(pressure_data->right_cop_ay) } };
+
+	for (int k = 0; k < 2; k++)
 	{
-		*cop_x = 0;
+		cop_kalman[k].Update(cop_x[k], cop_y[k], pressure[k] > cop_min_load, pressure_data->time_stamp);
+
+		// state rows : position, velocity, acceleration ; columns : x, y
+		const COPKalman::State& state = cop_kalman[k].getState();
+		bool tracking = cop_kalman[k].isTracking();
+		for (int i = 0; i < 6; i++)
+			*output[k][i] = tracking ? state(i / 2, i % 2) : 0;
 	}
-	else
+}
+
+
+/*
+@brief	Get the fixed-lag smoothed COP of one foot (delayed by the lag of InitCOPKalman), for logging
+
+@param[in]	foot		1 -> left ; 2 -> right
+@param[out]	cop_x		smoothed x-coordinate of the COP
+@param[out]	cop_y		smoothed y-coordinate of the COP
+@param[out]	time_stamp	time-stamp of the frame the smoothed COP belongs to
+
+@return	false if not enough frames of the current contact were tracked yet
+*/
+bool FootSensor::getSmoothedCOP(int foot, float* cop_x, float* cop_y, double* time_stamp)
+{
+	COPKalman::State smoothed;
+	if (!cop_kalman[foot - 1].getSmoothed(&smoothed, time_stamp))
+		return false;
+
+	*cop_x = smoothed(0, 0);
+	*cop_y = smoothed(0, 1);
+	return true;
+}
+
+
+/*
+@brief	Calculate contact area and connected contact blobs of each foot-sensor, from the contact bitboards of ReadPressureData()
+Area is a popcount ; blobs (e.g. separate heel & forefoot contacts) come from a bit-parallel flood fill.
+
+@param[in/out]	pressure_data	struct that contains the contact bitboards as input and contact area & blobs as output
+
+@return nothing
+*/
+void FootSensor::CalcContact(PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::CalcContact");
+
+	// Unchanged pixels -> same contact mask as the previous frame
+	if (pressure_data->right_changed)
+	{
+		pressure_data->right_contact_area = pressure_data->right_contact.Area();
+		pressure_data->right_contact_blobs = pressure_data->right_contact.Segment(pressure_data->right_blob, PressureData::max_blob);
+	}
+	if (pressure_data->left_changed)
 	{
-		*cop_x = ((pressure_mat->transpose()) * (multiplier_rowX)).sum() / pressure_sum;
+		pressure_data->left_contact_area = pressure_data->left_contact.Area();
+		pressure_data->left_contact_blobs = pressure_data->left_contact.Segment(pressure_data->left_blob, PressureData::max_blob);
 	}
 }
 
 
 /*
-@brief	Call the calculating-COP method for each foot-sensor, then save COP results
+@brief	Change the anatomical geometry of the regional loads (see FootRegions)
+
+@param[in]	heel_at_first_row			true -> row 0 is under the heel ; false -> row 0 is under the toes
+@param[in]	right_medial_at_first_col	true -> column 0 of the right sensor is on the big-toe side
+
+@return	the region masks, to override single pixels with FootRegions::setRegion()
+*/
+FootRegions* FootSensor::InitFootRegions(bool heel_at_first_row, bool right_medial_at_first_col)
+{
+	foot_regions.Init(heel_at_first_row, right_medial_at_first_col);
+	return &foot_regions;
+}
 
-@param[in/out]	pressure_data	struct that contains pressure-pixels as input and COP-x/y as output
+
+
+/*
+@brief	Configure the Butterworth low-pass filter applied to every pixel of both foot-sensors
+
+@param[in]	cutoff_hz	-3dB cut-off frequency
+@param[in]	sample_hz	rate at which CalcFilteredCOP() is called (i.e. the loop rate)
+@param[in]	order		Butterworth order, rounded up to an even number [default=2]
+*/
+void FootSensor::InitPressureFilter(float cutoff_hz, float sample_hz, int order)
+{
+	pressure_filter.Init(cutoff_hz, sample_hz, order);
+}
+
+
+/*
+@brief	Low-pass filter all 210 pixels, then calculate the FILTERED pressure-sum & COP
+The RAW pixels, pressure-sum & COP are left untouched.
+The first call after InitPressureFilter() primes the filter with the current reading.
+
+@param[in/out]	pressure_data	struct that contains RAW pixels as input and FILTERED pixels, sums & COP as output
 
 @return nothing
 */
-void FootSensor::CalcCOP(PressureData* pressure_data)
+void FootSensor::CalcFilteredCOP(PressureData* pressure_data)
 {
-	pressure_data->right_pressure = pressure_data->sensor_right.sum();
-	pressure_data->left_pressure = pressure_data->sensor_left.sum();
+	TRACE_SCOPE("FootSensor::CalcFilteredCOP");
+
+	const int n_cell = PressureFilter::n_cell;
+	const int n_stride = PressureFilter::n_stride;
+
+	// Gather both feet into the padded lanes of the filter bank
+	filter_cells.segment<n_cell>(0) = Eigen::Map<Eigen::Array<int, n_cell, 1> >(pressure_data->sensor_left.data()).cast<float>();
+	filter_cells.segment<n_cell>(n_stride) = Eigen::Map<Eigen::Array<int, n_cell, 1> >(pressure_data->sensor_right.data()).cast<float>();
+
+	pressure_filter.Process(&filter_cells);
+
+	// Scatter back to the 15x7 matrices
+	Eigen::Map<Eigen::Array<float, n_cell, 1> >(pressure_data->sensor_left_filt.data()) = filter_cells.segment<n_cell>(0);
+	Eigen::Map<Eigen::Array<float, n_cell, 1> >(pressure_data->sensor_right_filt.data()) = filter_cells.segment<n_cell>(n_stride);
+
+	pressure_data->right_pressure_filt = pressure_data->sensor_right_filt.sum();
+	pressure_data->left_pressure_filt = pressure_data->sensor_left_filt.sum();
 
-	CalcCOP_SingleSensor(&(pressure_data->sensor_right), &(pressure_data->right_cop_x), &(pressure_data->right_cop_y));
-	CalcCOP_SingleSensor(&(pressure_data->sensor_left), &(pressure_data->left_cop_x), &(pressure_data->left_cop_y));
+	CalcCOP_SingleSensor(&(pressure_data->sensor_right_filt), &(pressure_data->right_cop_x_filt), &(pressure_data->right_cop_y_filt));
+	CalcCOP_SingleSensor(&(pressure_data->sensor_left_filt), &(pressure_data->left_cop_x_filt), &(pressure_data->left_cop_y_filt));
 }
 
 
@@ -228,12 +553,24 @@ void FootSensor::FilterSpike_Init(USBStream* serial_port, PressureData* pressure
 {
 	pressure_data->sensor_right.setZero(pressure_data->n_row, pressure_data->n_col);
 	pressure_data->sensor_left.setZero(pressure_data->n_row, pressure_data->n_col);
+	pressure_data->sensor_right_filt.setZero(pressure_data->n_row, pressure_data->n_col);
+	pressure_data->sensor_left_filt.setZero(pressure_data->n_row, pressure_data->n_col);
 
     ReadPressureData(serial_port, pressure_data);
 	
     pressure_data->right_pressure_prev = pressure_data->sensor_right.sum();
     pressure_data->left_pressure_prev = pressure_data->sensor_left.sum();
 
+	// First sample of the gradiant estimators
+	pressure_deriv[1].Reset();
+	pressure_deriv[0].Reset();
+	pressure_deriv[1].Update(pressure_data->right_pressure_prev, pressure_data->time_stamp);
+	pressure_deriv[0].Update(pressure_data->left_pressure_prev, pressure_data->time_stamp);
+
+	// The average pressure-sum starts over too : no sample from before the re-initialization
+	pressure_aver_deriv[1].Reset();
+	pressure_aver_deriv[0].Reset();
+
     time_point_prev = std::chrono::steady_clock::now();
 }
 
@@ -251,6 +588,8 @@ The 2nd-next reading will resume filtering again.
 */
 void FootSensor::FilterSpike(PressureData* pressure_data, bool* spike_check)
 {
+	TRACE_SCOPE("FootSensor::FilterSpike");
+
     // Refer the pressure-threshold from the header-file
 
     // Calculate the pressure_threshold
@@ -260,6 +599,7 @@ void FootSensor::FilterSpike(PressureData* pressure_data, bool* spike_check)
     if((pressure_data->right_pressure_grad > threshold) && (spike_check[0]==true))
     {
         pressure_data->right_pressure = pressure_data->right_pressure_prev;
+        pressure_deriv[1].ReplaceLast(pressure_data->right_pressure);
         spike_check[0] = false;
     }
     else 
@@ -269,6 +609,7 @@ void FootSensor::FilterSpike(PressureData* pressure_data, bool* spike_check)
     if((pressure_data->left_pressure_grad > threshold) && (spike_check[1] == true))
     {
         pressure_data->left_pressure = pressure_data->left_pressure_prev;
+        pressure_deriv[0].ReplaceLast(pressure_data->left_pressure);
         spike_check[1] = false;
     }
     else
@@ -282,6 +623,8 @@ Thresholds of left & right foot-sensor are different.
 
 getHeelStrike is only triggered during Swing phase.
 
+With setHeelStrikeConfirmation(1), the heel-strike fires at the 1st-stage (one frame earlier).
+
 @param[in]	pressure_data	struct that contains the pressure-sum & COP
 @param[in]	heel_check		
 
@@ -289,6 +632,8 @@ getHeelStrike is only triggered during Swing phase.
 */
 int FootSensor::getHeelStrike(PressureData* pressure_data, int* heel_check)
 {
+	TRACE_SCOPE("FootSensor::getHeelStrike");
+
 	// Calculate the AVERAGE pressure_gradiant
 	CalcPressureAverGrad(pressure_data);
 
@@ -317,6 +662,15 @@ int FootSensor::getHeelStrike(PressureData* pressure_data, int* heel_check)
 		{
 			heel_check[1] = 1;
 		}
+
+		// Single-stage checking : the smoothed gradiant is trusted on the 1st frame
+		if ( heel_confirm_stages <= 1 && heel_check[1] > 0 )
+		{
+			int heel_strike = heel_check[1];
+			heel_check[0] = 0;
+			heel_check[1] = 0;
+			return heel_strike;
+		}
 	}
 	else return 0;
 
@@ -324,3 +678,431 @@ int FootSensor::getHeelStrike(PressureData* pressure_data, int* heel_check)
 }
 
 
+
+
+
+/*
+@brief	Get the heel & forefoot loads of one foot-sensor from its regional loads
+This is an internal function, not used in main().
+
+@param[in]	regional		regional loads of the foot (from CalcCOP)
+@param[in]	cop_x			the x-coordinate of the COP (from CalcCOP)
+@param[out]	heel_load		pressure-sum of the heel region
+@param[out]	forefoot_load	pressure-sum of the metatarsal heads & toes
+@param[out]	heel_cells		number of heel pixels above contact_threshold
+@param[out]	cop_toe			COP along the foot, increasing towards the toes
+
+@return	nothing
+*/
+void FootSensor::CalcHeelForefoot(RegionalLoad *regional, float cop_x, float *heel_load, float *forefoot_load, int *heel_cells, float *cop_toe)
+{
+	*heel_load = regional->load[kRegionHeel];
+	*forefoot_load = regional->load[kRegionMetatarsal] + regional->load[kRegionHallux] + regional->load[kRegionLesserToes];
+	*heel_cells = regional->active_cells[kRegionHeel];
+
+	if (foot_regions.isHeelAtFirstRow())
+		*cop_toe = cop_x;								// cop_x grows towards the toes
+	else
+		*cop_toe = (FootRegions::n_row + 1) - cop_x;	// cop_x grows towards the heel
+}
+
+
+/*
+@brief	Set the number of consecutive frames of pressure-gradiant above threshold before getHeelStrike() fires
+
+@param[in]	stages	2 -> 2-stage confirmation (default) ; 1 -> fire on the 1st frame
+*/
+void FootSensor::setHeelStrikeConfirmation(int stages)
+{
+	heel_confirm_stages = stages;
+}
+
+
+/*
+@brief	Configure the single-frame (predictive) heel-strike detection of both feet
+
+@param[in]	config	thresholds of the shape checks
+*/
+void FootSensor::InitHeelStrike_Predictive(const HeelStrikePredictorConfig& config)
+{
+	predictor_config = config;
+	heel_predictor[0].Init(config);
+	heel_predictor[1].Init(config);
+}
+
+
+/*
+@brief	Determine the heel-strike on the FIRST frame of heel loading.
+Unlike getHeelStrike(), no 2nd-stage confirmation is needed:
+false-positives are rejected from the heel-onset shape and the COP velocity (see HeelStrikePredictor).
+Call once per frame, after CalcCOP().
+
+@param[in]	pressure_data	struct that contains the pixels, COP & time-stamp
+
+@return 	0->no heelstrike ; 1->left heelstrike ; 2->right heelstrike
+*/
+int FootSensor::getHeelStrike_Predictive(PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::getHeelStrike_Predictive");
+
+	RegionalLoad* regional[2] = { &(pressure_data->left_regions), &(pressure_data->right_regions) };
+	float total[2] = { pressure_data->left_pressure, pressure_data->right_pressure };
+	float cop_x[2] = { pressure_data->left_cop_x, pressure_data->right_cop_x };
+
+	int heel_strike = 0;
+	for (int k = 0; k < 2; k++)
+	{
+		HeelStrikeInput input;
+		float forefoot_load;
+		CalcHeelForefoot(regional[k], cop_x[k], &input.heel_load, &forefoot_load, &input.heel_cells, &input.cop_toe);
+		input.total_load = total[k];
+		input.time_stamp = pressure_data->time_stamp;
+
+		// Both predictors must see every frame ; right foot wins if both fire together (same as getHeelStrike)
+		if (heel_predictor[k].Update(input))
+			heel_strike = k + 1;
+	}
+
+	return heel_strike;
+}
+
+
+/*
+@brief	Measure the latency of getHeelStrike_Predictive() on a recorded session of one foot
+
+The session is replayed through a fresh predictor (causal, frame by frame),
+and compared to the ground truth found OFFLINE over the whole session (see HeelStrikePredictor::FindGroundTruth).
+
+@param[in]	frames		recorded session, e.g. from MatrixIO::readPressureFrames() (RealTimeFileIO::initPressure() log)
+@param[in]	foot		1 -> left ; 2 -> right
+@param[out]	report		counts of detected / missed / false heel-strikes and latency statistics
+*/
+void FootSensor::EvaluateHeelStrikeLatency(const std::vector<PressureFrame>& frames, int foot, HeelStrikeLatencyReport* report)
+{
+	const int n_cell = 105;
+	const float max_latency = 0.2f;	// matching window between detection and ground truth (in seconds)
+
+	HeelStrikePredictor predictor;
+	predictor.Init(predictor_config);
+
+	std::vector<HeelStrikeInput> inputs(frames.size());
+	std::vector<double> detected;
+	int pixels[n_cell];
+	RegionalLoad regional;
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const uint16_t* cells = frames[i].cells[foot - 1];
+		for (int j = 0; j < n_cell; j++)
+			pixels[j] = cells[j];
+
+		float cop_x, cop_y, forefoot_load;
+		HeelStrikeInput& input = inputs[i];
+		foot_regions.Calc(foot - 1, pixels, contact_threshold, &input.total_load, &cop_x, &cop_y, &regional);
+		CalcHeelForefoot(&regional, cop_x, &input.heel_load, &forefoot_load, &input.heel_cells, &input.cop_toe);
+		input.time_stamp = frames[i].time_stamp;
+
+		if (predictor.Update(input))
+			detected.push_back(input.time_stamp);
+	}
+
+	std::vector<double> truth;
+	HeelStrikePredictor::FindGroundTruth(inputs, predictor_config.swing_load, predictor_config.min_swing, &truth);
+	HeelStrikePredictor::CompareToGroundTruth(detected, truth, max_latency, report);
+}
+
+
+/*
+@brief	Configure the gait event state machine of both feet
+
+@param[in]	config	thresholds of heel-strike, foot-flat, heel-off & toe-off
+*/
+void FootSensor::InitGaitEvents(const GaitEventConfig& config)
+{
+	gait_detector[0].Init(1, config);	// left
+	gait_detector[1].Init(2, config);	// right
+}
+
+
+/*
+@brief	Detect heel-strike, foot-flat, heel-off and toe-off of both feet.
+Uses the heel & forefoot regional loads and the COP progression along the foot.
+Call once per frame, after CalcCOP(). Runs in constant time.
+Detected events are also published on the event bus, if set (see setEventBus()).
+
+@param[in/out]	pressure_data	struct that contains the pixels, COP & time-stamp as input and gait phases as output
+@param[out]		events			array of (at least) 2 records to store the detected events
+
+@return 	number of events stored in events[] (0, 1 or 2)
+*/
+int FootSensor::getGaitEvents(PressureData* pressure_data, GaitEventRecord* events)
+{
+	TRACE_SCOPE("FootSensor::getGaitEvents");
+
+	RegionalLoad* regional[2] = { &(pressure_data->left_regions), &(pressure_data->right_regions) };
+	float total[2] = { pressure_data->left_pressure, pressure_data->right_pressure };
+	float cop_x[2] = { pressure_data->left_cop_x, pressure_data->right_cop_x };
+	int* gait_phase[2] = { &(pressure_data->left_gait_phase), &(pressure_data->right_gait_phase) };
+	int* gait_event[2] = { &(pressure_data->left_gait_event), &(pressure_data->right_gait_event) };
+
+	int num_event = 0;
+
+	for (int k = 0; k < 2; k++)
+	{
+		float heel_load, forefoot_load, cop_toe;
+		int heel_cells;
+		CalcHeelForefoot(regional[k], cop_x[k], &heel_load, &forefoot_load, &heel_cells, &cop_toe);
+
+		*gait_event[k] = gait_detector[k].Update(heel_load, forefoot_load, total[k], cop_toe, pressure_data->time_stamp, &events[num_event]);
+		if (*gait_event[k] != kNoEvent)
+		{
+			if (event_bus)
+				event_bus->Publish(events[num_event], pressure_data->frame_seq);
+			num_event++;
+		}
+
+		*gait_phase[k] = gait_detector[k].getPhase();
+	}
+
+	return num_event;
+}
+
+
+/*
+@brief	Accumulate the current frame into the peak-pressure & pressure-time-integral maps of both feet.
+The step maps of a foot are closed at its heel-strike. Call once per frame, after getGaitEvents().
+
+@param[in]	pressure_data	struct that contains the pixels & time-stamp
+@param[in]	events			gait events of the current frame (from getGaitEvents)
+@param[in]	num_event		number of events in events[]
+*/
+void FootSensor::UpdatePressureMaps(PressureData* pressure_data, const GaitEventRecord* events, int num_event)
+{
+	TRACE_SCOPE("FootSensor::UpdatePressureMaps");
+
+	for (int i = 0; i < num_event; i++)
+	{
+		if (events[i].event == kHeelStrike)
+			pressure_map[events[i].foot - 1].NewStep();
+	}
+
+	// Unloaded foot that stays unloaded adds nothing to the maps
+	if (!(pressure_data->left_all_zero && !pressure_data->left_changed))
+		pressure_map[0].Update(pressure_data->sensor_left, pressure_data->time_stamp);
+	else
+		pressure_map[0].Skip(pressure_data->time_stamp);
+	if (!(pressure_data->right_all_zero && !pressure_data->right_changed))
+		pressure_map[1].Update(pressure_data->sensor_right, pressure_data->time_stamp);
+	else
+		pressure_map[1].Skip(pressure_data->time_stamp);
+}
+
+
+/*
+@brief	Clear the step & session maps of both feet (e.g. at the start of a new session)
+*/
+void FootSensor::ResetPressureMaps()
+{
+	pressure_map[0].Reset();
+	pressure_map[1].Reset();
+}
+
+
+/*
+@brief	Access the peak-pressure & pressure-time-integral maps of one foot
+
+@param[in]	foot	1 -> left ; 2 -> right
+
+@return	the maps, readable at any time as [15x7]
+*/
+PressureMap* FootSensor::getPressureMap(int foot)
+{
+	return &pressure_map[foot - 1];
+}
+
+
+/*
+@brief	Copy the current frame into the compact PressureFrame record (RAW pixels as uint16 & derived scalars)
+
+@param[in]	pressure_data	struct that contains the current frame
+@param[out]	frame			the compact record
+*/
+void FootSensor::PackFrame(PressureData* pressure_data, PressureFrame* frame)
+{
+	const int n_cell = 105;
+
+	frame->time_stamp = pressure_data->time_stamp;
+	frame->seq = pressure_data->frame_seq;
+	frame->event_flags = PressureFrameEventFlag(1, pressure_data->left_gait_event) | PressureFrameEventFlag(2, pressure_data->right_gait_event);
+	frame->gait_phase[0] = (uint8_t)pressure_data->left_gait_phase;
+	frame->gait_phase[1] = (uint8_t)pressure_data->right_gait_phase;
+	frame->contact_area[0] = (uint8_t)pressure_data->left_contact_area;
+	frame->contact_area[1] = (uint8_t)pressure_data->right_contact_area;
+	frame->changed = (uint8_t)((pressure_data->left_changed ? 1 : 0) | (pressure_data->right_changed ? 2 : 0));
+	memset(frame->reserved, 0, sizeof(frame->reserved));
+	memset(frame->reserved_end, 0, sizeof(frame->reserved_end));
+
+	frame->pressure[0] = pressure_data->left_pressure;
+	frame->pressure[1] = pressure_data->right_pressure;
+	frame->cop_x[0] = pressure_data->left_cop_x;
+	frame->cop_x[1] = pressure_data->right_cop_x;
+	frame->cop_y[0] = pressure_data->left_cop_y;
+	frame->cop_y[1] = pressure_data->right_cop_y;
+	frame->pressure_grad[0] = pressure_data->left_pressure_grad;
+	frame->pressure_grad[1] = pressure_data->right_pressure_grad;
+
+	const int* left = pressure_data->sensor_left.data();
+	const int* right = pressure_data->sensor_right.data();
+	for (int i = 0; i < n_cell; i++)
+	{
+		frame->cells[0][i] = (uint16_t)left[i];
+		frame->cells[1][i] = (uint16_t)right[i];
+	}
+}
+
+
+/*
+@brief	Append the current frame to the history ring, in place (O(1), no allocation).
+The packed frame is also published to the shared memory and to the sinks, if set (see setSharedMemory(), setFrameFanout()).
+Call once per frame, after all values of the frame are calculated.
+
+@param[in]	pressure_data	struct that contains the current frame
+*/
+void FootSensor::StoreHistory(PressureData* pressure_data)
+{
+	TRACE_SCOPE("FootSensor::StoreHistory");
+
+	PressureFrame* frame = history.Append();
+	PackFrame(pressure_data, frame);
+
+	if (shared_memory)
+		shared_memory->Publish(*frame);
+
+	// One copy into the pool, whatever the number of sinks
+	if (frame_fanout)
+	{
+		PressureFrame* shared_frame = frame_fanout->Acquire();
+		if (shared_frame)
+		{
+			*shared_frame = *frame;
+			frame_fanout->Publish(shared_frame);
+		}
+	}
+}
+
+/*
+@brief	Register the per-frame calculations of FootSensor as metrics of a MetricGraph
+
+Consumers then subscribe only to what they read, e.g. a heel-strike-only controller subscribes to "heel_strike"
+and only "raw" -> "cop" -> "heel_strike" run each frame.
+
+	raw				ReadPressureData()
+	cop				CalcCOP() (total & regional)			<- raw
+	contact			CalcContact()							<- raw
+	filtered_cop	CalcFilteredCOP()						<- raw
+	cop_kalman		CalcCOPKalman()							<- cop
+	pressure_grad	CalcPressureGradiant()					<- cop
+	gait_events		getGaitEvents(), see getFrameEvents()	<- cop
+	heel_strike		getHeelStrike_Predictive() -> PressureData::heel_strike	<- cop
+	pressure_maps	UpdatePressureMaps()					<- gait_events
+	history			StoreHistory()							<- cop, contact, pressure_grad, gait_events
+
+@param[in]	graph		graph to register into (FootSensor must outlive its evaluation)
+@param[in]	serial_port	opened serial ports of both feet, read by "raw"
+*/
+void FootSensor::RegisterMetrics(MetricGraph* graph, USBStream* serial_port)
+{
+	metric_serial_port = serial_port;
+
+	static const char* const on_raw[] = { "raw" };
+	static const char* const on_cop[] = { "cop" };
+	static const char* const on_events[] = { "gait_events" };
+	static const char* const on_frame[] = { "cop", "contact", "pressure_grad", "gait_events" };
+
+	graph->Register("raw", MetricRead, this);
+	graph->Register("cop", MetricCOP, this, on_raw, 1);
+	graph->Register("contact", MetricContact, this, on_raw, 1);
+	graph->Register("filtered_cop", MetricFilteredCOP, this, on_raw, 1);
+	graph->Register("cop_kalman", MetricCOPKalman, this, on_cop, 1);
+	graph->Register("pressure_grad", MetricPressureGrad, this, on_cop, 1);
+	graph->Register("gait_events", MetricGaitEvents, this, on_cop, 1);
+	graph->Register("heel_strike", MetricHeelStrike, this, on_cop, 1);
+	graph->Register("pressure_maps", MetricPressureMaps, this, on_events, 1);
+	graph->Register("history", MetricHistory, this, on_frame, 4);
+}
+
+
+/*
+@brief	Get the gait events detected by the "gait_events" metric in the current frame
+
+@param[out]	events	pointer to the events of the frame
+@return	number of events
+*/
+int FootSensor::getFrameEvents(const GaitEventRecord** events)
+{
+	*events = metric_events;
+	return metric_num_event;
+}
+
+
+void FootSensor::MetricRead(void* context, PressureData* pressure_data)
+{
+	FootSensor* self = static_cast<FootSensor*>(context);
+	self->ReadPressureData(self->metric_serial_port, pressure_data);
+}
+
+
+void FootSensor::MetricCOP(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->CalcCOP(pressure_data);
+}
+
+
+void FootSensor::MetricContact(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->CalcContact(pressure_data);
+}
+
+
+void FootSensor::MetricFilteredCOP(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->CalcFilteredCOP(pressure_data);
+}
+
+
+void FootSensor::MetricCOPKalman(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->CalcCOPKalman(pressure_data);
+}
+
+
+void FootSensor::MetricPressureGrad(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->CalcPressureGradiant(pressure_data);
+}
+
+
+void FootSensor::MetricGaitEvents(void* context, PressureData* pressure_data)
+{
+	FootSensor* self = static_cast<FootSensor*>(context);
+	self->metric_num_event = self->getGaitEvents(pressure_data, self->metric_events);
+}
+
+
+void FootSensor::MetricHeelStrike(void* context, PressureData* pressure_data)
+{
+	pressure_data->heel_strike = static_cast<FootSensor*>(context)->getHeelStrike_Predictive(pressure_data);
+}
+
+
+void FootSensor::MetricPressureMaps(void* context, PressureData* pressure_data)
+{
+	FootSensor* self = static_cast<FootSensor*>(context);
+	self->UpdatePressureMaps(pressure_data, self->metric_events, self->metric_num_event);
+}
+
+
+void FootSensor::MetricHistory(void* context, PressureData* pressure_data)
+{
+	static_cast<FootSensor*>(context)->StoreHistory(pressure_data);
+}
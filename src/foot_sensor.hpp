@@ -10,6 +10,20 @@
 
 #include "serial_stream.hpp"
 #include "matrix_io.hpp"
+#include "pressure_filter.hpp"
+#include "gait_event.hpp"
+#include "heel_strike_predictor.hpp"
+#include "foot_regions.hpp"
+#include "contact_bitboard.hpp"
+#include "pressure_map.hpp"
+#include "cop_kalman.hpp"
+#include "streaming_derivative.hpp"
+#include "pressure_frame.hpp"
+#include "frame_history.hpp"
+#include "metric_graph.hpp"
+#include "gait_event_bus.hpp"
+#include "pressure_shm.hpp"
+#include "frame_fanout.hpp"
 
 
 using namespace std;
@@ -17,13 +31,23 @@ using namespace std;
 
 struct PressureData
 {
-	const int n_row = 15;
-	const int n_col = 7;
-	const int sensor_size = n_row * n_col;
+	static const int n_row = 15;
+	static const int n_col = 7;
+	static const int sensor_size = n_row * n_col;
 
 	Eigen::MatrixXi sensor_left;
 	Eigen::MatrixXi sensor_right;
 
+	// Time-stamp of reading the foot-sensors, in seconds since FootSensor was created
+	double time_stamp = 0;
+	uint32_t frame_seq = 0;		// sequence number of the reading, +1 per ReadPressureData()
+
+	// Change detection of ReadPressureData() : unchanged pixels let CalcCOP() & co. reuse the previous results
+	bool right_changed = true;		// false -> pixels bit-identical to the previous frame
+	bool left_changed = true;
+	bool right_all_zero = false;	// true -> all pixels are zero (foot in the air)
+	bool left_all_zero = false;
+
 	float right_cop_x = 0;
 	float left_cop_x = 0;
 	float right_cop_y = 0;
@@ -31,6 +55,21 @@ struct PressureData
 	float right_pressure = 0;
 	float left_pressure = 0;
 
+	// Pressure-sum, COP & loaded pixels of each anatomical region (heel, midfoot, metatarsal heads, toes)
+	RegionalLoad right_regions;
+	RegionalLoad left_regions;
+
+	// Contact mask (pixels above threshold) as bitboard, its area & connected blobs (see FootSensor::CalcContact)
+	static const int max_blob = 4;
+	ContactBitboard right_contact;
+	ContactBitboard left_contact;
+	int right_contact_area = 0;
+	int left_contact_area = 0;
+	int right_contact_blobs = 0;
+	int left_contact_blobs = 0;
+	ContactBitboard right_blob[max_blob];
+	ContactBitboard left_blob[max_blob];
+
     float right_cop_x_average = 0;
 	float left_cop_x_average = 0;
 	float right_cop_y_average = 0;
@@ -63,23 +102,97 @@ struct PressureData
 	float left_pressure_aver_grad = 0;
 	float right_pressure_aver_prev = 0;
 	float left_pressure_aver_prev = 0;
+
+	// Low-pass filtered pixels, with their pressure-sum & COP, calculated alongside the RAW values
+	Eigen::MatrixXf sensor_left_filt;
+	Eigen::MatrixXf sensor_right_filt;
+
+	float right_cop_x_filt = 0;
+	float left_cop_x_filt = 0;
+	float right_cop_y_filt = 0;
+	float left_cop_y_filt = 0;
+	float right_pressure_filt = 0;
+	float left_pressure_filt = 0;
+
+	// Kalman-filtered COP with its velocity (pixels/s) & acceleration (pixels/s^2), see FootSensor::CalcCOPKalman
+	float right_cop_x_kf = 0;
+	float left_cop_x_kf = 0;
+	float right_cop_y_kf = 0;
+	float left_cop_y_kf = 0;
+	float right_cop_vx = 0;
+	float left_cop_vx = 0;
+	float right_cop_vy = 0;
+	float left_cop_vy = 0;
+	float right_cop_ax = 0;
+	float left_cop_ax = 0;
+	float right_cop_ay = 0;
+	float left_cop_ay = 0;
+
+	// Gait phase of each foot (GaitPhase), updated by getGaitEvents()
+	int right_gait_phase = kSwing;
+	int left_gait_phase = kSwing;
+
+	// Gait event detected in this frame (GaitEvent), kNoEvent otherwise
+	int right_gait_event = kNoEvent;
+	int left_gait_event = kNoEvent;
+
+	// Heel-strike of this frame (0 -> nothing ; 1 -> left ; 2 -> right), set by the "heel_strike" metric
+	int heel_strike = 0;
 };
 
 
 
+// RAW packets of both foot-sensors as read from the serial ports, see FootSensor::ReadPressurePacket()
+struct PressurePacket
+{
+	unsigned char data[2][210];	// 105x <uint16_t> per foot : [0] -> left ; [1] -> right
+	double time_stamp = 0;		// see PressureData::time_stamp
+	uint32_t seq = 0;			// see PressureData::frame_seq
+};
+
+
+
+// History of the last frames (about 5 s at 50 Hz)
+typedef FrameHistory<256> PressureHistory;
+
+
 class FootSensor
 {
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW	// needed for the fixed-size filter state
+
 	void OpenSerialPort(USBStream* serial_port);
 
+	bool OpenSerialPort(USBStream* serial_port, const char* comport_left, const char* comport_right);
+
 	void ReadPressureData(USBStream* serial_port, PressureData* pressure_data);
 
+	bool ReadPressurePacket(USBStream* serial_port, PressurePacket* packet);
+
+	void setReadTimeout(int timeout) { read_timeout = timeout; }
+
+	void DecodePressureData(const PressurePacket* packet, PressureData* pressure_data);
+
 	void CalcPressureGradiant(PressureData* pressure_data);
 
 	void CalcPressureAverGrad(PressureData* pressure_data);
 
 	void CalcCOP(PressureData* pressure_data);
 
+	void CalcContact(PressureData* pressure_data);
+
+	void InitCOPKalman(float jerk_noise, float measurement_noise, int lag = 0);
+
+	void CalcCOPKalman(PressureData* pressure_data);
+
+	bool getSmoothedCOP(int foot, float* cop_x, float* cop_y, double* time_stamp);
+
+	FootRegions* InitFootRegions(bool heel_at_first_row, bool right_medial_at_first_col);
+
+	void InitPressureFilter(float cutoff_hz, float sample_hz, int order = 2);
+
+	void CalcFilteredCOP(PressureData* pressure_data);
+
     void FilterSpike_Init(USBStream* serial_port, PressureData* pressure_data);
 
     void FilterSpike(PressureData* pressure_data, bool* spike_check);
@@ -88,21 +201,123 @@ public:
 
 	int getHeelStrike(PressureData* pressure_data, int* heel_check);
 
+	void setHeelStrikeConfirmation(int stages);
+
+	void InitHeelStrike_Predictive(const HeelStrikePredictorConfig& config);
+
+	int getHeelStrike_Predictive(PressureData* pressure_data);
+
+	void EvaluateHeelStrikeLatency(const std::vector<PressureFrame>& frames, int foot, HeelStrikeLatencyReport* report);
+
+	void InitGaitEvents(const GaitEventConfig& config);
+
+	int getGaitEvents(PressureData* pressure_data, GaitEventRecord* events);
+
+	void setEventBus(GaitEventBus* bus) { event_bus = bus; }
+
+	void UpdatePressureMaps(PressureData* pressure_data, const GaitEventRecord* events, int num_event);
+
+	void ResetPressureMaps();
+
+	PressureMap* getPressureMap(int foot);
+
+	void PackFrame(PressureData* pressure_data, PressureFrame* frame);
+
+	void StoreHistory(PressureData* pressure_data);
+
+	const PressureHistory* getHistory() { return &history; }
+
+	void setSharedMemory(PressureShmWriter* writer) { shared_memory = writer; }
+
+	void setFrameFanout(FrameFanout* fanout) { frame_fanout = fanout; }
+
+	void RegisterMetrics(MetricGraph* graph, USBStream* serial_port);
+
+	int getFrameEvents(const GaitEventRecord** events);
+
 
 private:
 	// time_interval is used for calculating pressure gradiants
+	std::chrono::time_point<std::chrono::steady_clock> time_point_start = std::chrono::steady_clock::now();
 	std::chrono::time_point<std::chrono::steady_clock> time_point_prev;
 	std::chrono::time_point<std::chrono::steady_clock> time_point_curr;
 	std::chrono::duration<float, std::ratio<1, 1>> time_interval;	// in seconds
+	uint32_t frame_count = 0;
+
+	// Time-out of each serial read (in ms, libserial), see setReadTimeout()
+	int read_timeout = 1;
+
+	// Packets of ReadPressureData()
+	PressurePacket read_packet;
+
+	// Last packet of each foot, for change detection : [0] -> left ; [1] -> right
+	unsigned char last_packet[2][210] = { { 0 } };
 
 	// Threshold to check for heel strike
 	const float right_pressure_threshold = 30000;
 	const float left_pressure_threshold = 20000;
 
+	// Frames of pressure-gradiant above threshold before a heel strike is confirmed
+	int heel_confirm_stages = 2;
+
+	// Savitzky-Golay derivatives of the RAW & AVERAGE pressure-sums : [0] -> left ; [1] -> right
+	StreamingDerivative<5> pressure_deriv[2];
+	StreamingDerivative<5> pressure_aver_deriv[2];
+
 	// Threshold to filter the spike when reading foot-sensor
 	const int threshold = 10000000;
 
-	void CalcCOP_SingleSensor(Eigen::MatrixXi *pressure_mat, float *CoP_x, float *CoP_y);
+	// Threshold of a single pixel to be counted as loaded
+	const int contact_threshold = 50;
+
+	// Gait event state machine of each foot : [0] -> left ; [1] -> right
+	GaitEventDetector gait_detector[2];
+	GaitEventBus* event_bus = NULL;		// events are also published here, if set
+
+	// Frames stored by StoreHistory(), shared by all windowed algorithms
+	PressureHistory history;
+	PressureShmWriter* shared_memory = NULL;	// frames are also published here, if set
+	FrameFanout* frame_fanout = NULL;			// and handed to the sink threads here, if set
+
+	// Peak-pressure & pressure-time-integral maps of each foot : [0] -> left ; [1] -> right
+	PressureMap pressure_map[2];
+
+	// COP Kalman filter & fixed-lag smoother of each foot : [0] -> left ; [1] -> right
+	COPKalman cop_kalman[2];
+	const float cop_min_load = 500;	// COP is tracked above this pressure-sum
+
+	// Single-frame heel-strike detection of each foot : [0] -> left ; [1] -> right
+	HeelStrikePredictorConfig predictor_config;
+	HeelStrikePredictor heel_predictor[2];
+
+	// Precomputed anatomical region masks of both feet
+	FootRegions foot_regions;
+
+	// Butterworth filter bank of all pixels of both feet
+	PressureFilter pressure_filter;
+	PressureFilter::CellArray filter_cells;
+
+	void CalcCOP_SingleSensor(Eigen::MatrixXf *pressure_mat, float *CoP_x, float *CoP_y);
+
+	void DecodePressurePacket(int foot, const unsigned char* data, bool cached, Eigen::MatrixXi* pressure_mat, ContactBitboard* contact, bool* changed, bool* all_zero);
+
+	void CalcHeelForefoot(RegionalLoad *regional, float cop_x, float *heel_load, float *forefoot_load, int *heel_cells, float *cop_toe);
+
+	// Serial port & gait events of the current frame, used by the metrics of RegisterMetrics()
+	USBStream* metric_serial_port = NULL;
+	GaitEventRecord metric_events[2];
+	int metric_num_event = 0;
+
+	static void MetricRead(void* context, PressureData* pressure_data);
+	static void MetricCOP(void* context, PressureData* pressure_data);
+	static void MetricContact(void* context, PressureData* pressure_data);
+	static void MetricFilteredCOP(void* context, PressureData* pressure_data);
+	static void MetricCOPKalman(void* context, PressureData* pressure_data);
+	static void MetricPressureGrad(void* context, PressureData* pressure_data);
+	static void MetricGaitEvents(void* context, PressureData* pressure_data);
+	static void MetricHeelStrike(void* context, PressureData* pressure_data);
+	static void MetricPressureMaps(void* context, PressureData* pressure_data);
+	static void MetricHistory(void* context, PressureData* pressure_data);
 
 };
 
@@ -0,0 +1,210 @@
+#include <iostream>
+
+#include "frame_fanout.hpp"
+#include "trace.hpp"
+
+
+FrameFanout::FrameFanout()
+	: exhausted(0), running(false)
+{
+	for (int i = 0; i < num_frame; i++)
+		ref_count[i].count = 0;
+}
+
+
+FrameFanout::~FrameFanout()
+{
+	Stop();
+}
+
+
+/*
+@brief	Add a sink, before Start(). Each sink runs on its own thread.
+
+@param[in]	name		name of the sink, for the stats
+@param[in]	function	called for every frame, in publication order
+@param[in]	context		passed to the function
+@return	index of the sink, -1 if full or already started
+*/
+int FrameFanout::AddSink(const char* name, FrameSinkFunction function, void* context)
+{
+	if (num_sink >= max_sink || running.load())
+	{
+		std::cerr << "FrameFanout: cannot add sink " << name << std::endl;
+		return -1;
+	}
+
+	Sink& s = sink[num_sink];
+	s.name = name;
+	s.function = function;
+	s.context = context;
+	s.queue.Clear();
+	s.delivered = 0;
+	s.dropped = 0;
+	s.busy_ns = 0;
+	s.max_ns = 0;
+	return num_sink++;
+}
+
+
+/*
+@brief	Start one thread per sink
+*/
+bool FrameFanout::Start()
+{
+	if (running.load() || num_sink == 0)
+		return false;
+
+	running = true;
+	for (int i = 0; i < num_sink; i++)
+		thread[i] = std::thread(&FrameFanout::RunSink, this, i);
+	return true;
+}
+
+
+/*
+@brief	Stop and join the sink threads. Frames still queued are released without being delivered.
+*/
+void FrameFanout::Stop()
+{
+	running = false;
+	for (int i = 0; i < num_sink; i++)
+	{
+		sink[i].signal.Notify();
+		if (thread[i].joinable())
+			thread[i].join();
+
+		int index;
+		while (sink[i].queue.Pop(&index))
+			Release(&frame[index]);
+	}
+}
+
+
+/*
+@brief	Take a free frame of the pool, to be filled then published (producer thread only)
+
+@return	the frame, writable until Publish() ; NULL if all frames are still held by the sinks
+*/
+PressureFrame* FrameFanout::Acquire()
+{
+	for (int n = 0; n < num_frame; n++)
+	{
+		int index = next_free;
+		next_free = (next_free + 1) % num_frame;
+
+		// Only the producer takes a frame out of the pool : no other thread increments a count of 0
+		if (ref_count[index].count.load(std::memory_order_acquire) == 0)
+		{
+			ref_count[index].count.store(1, std::memory_order_relaxed);
+			return &frame[index];
+		}
+	}
+
+	exhausted.fetch_add(1, std::memory_order_relaxed);
+	return NULL;
+}
+
+
+/*
+@brief	Hand a frame taken with Acquire() to every sink, without copying it. The frame must not be modified anymore.
+*/
+void FrameFanout::Publish(PressureFrame* frame)
+{
+	int index = getIndex(frame);
+
+	// One reference per sink, taken before any sink can release it
+	ref_count[index].count.fetch_add(num_sink, std::memory_order_relaxed);
+	for (int i = 0; i < num_sink; i++)
+	{
+		if (!sink[i].queue.Push(index))
+		{
+			sink[i].dropped.fetch_add(1, std::memory_order_relaxed);
+			Release(frame);
+		}
+		else
+			sink[i].signal.Notify();
+	}
+
+	// Reference of the producer
+	Release(frame);
+}
+
+
+/*
+@brief	Keep a frame after the sink function returned, until Release()
+*/
+void FrameFanout::Retain(const PressureFrame* frame)
+{
+	ref_count[getIndex(frame)].count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Drop one reference, the frame goes back to the pool with the last one
+*/
+void FrameFanout::Release(const PressureFrame* frame)
+{
+	ref_count[getIndex(frame)].count.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+
+/*
+@brief	Number of frames of the pool not held by anyone (approximate while running)
+*/
+int FrameFanout::getNumFree()
+{
+	int num_free = 0;
+	for (int i = 0; i < num_frame; i++)
+		num_free += (ref_count[i].count.load(std::memory_order_relaxed) == 0);
+	return num_free;
+}
+
+
+/*
+@brief	Get the counters of a sink, while running or after Stop()
+*/
+void FrameFanout::getStats(int index, SinkStats* stats)
+{
+	const Sink& s = sink[index];
+	stats->name = s.name;
+	stats->delivered = s.delivered.load(std::memory_order_relaxed);
+	stats->dropped = s.dropped.load(std::memory_order_relaxed);
+	stats->mean_time = (stats->delivered > 0) ? 1e-9 * s.busy_ns.load(std::memory_order_relaxed) / stats->delivered : 0;
+	stats->max_time = 1e-9 * s.max_ns.load(std::memory_order_relaxed);
+	stats->queue_size = s.queue.size();
+}
+
+
+/*
+@brief	Thread of one sink : deliver the queued frames, then release them
+This is an internal function.
+*/
+void FrameFanout::RunSink(int index)
+{
+	Sink& s = sink[index];
+	Trace::setThreadName(s.name);
+
+	while (running.load(std::memory_order_relaxed))
+	{
+		int i;
+		if (!s.queue.Pop(&i))
+		{
+			// Sleep until Publish() queues a frame
+			s.signal.Wait([this, &s]() { return !running.load(std::memory_order_relaxed) || !s.queue.isEmpty(); }, 0.1);
+			continue;
+		}
+
+		auto time_point_begin = std::chrono::steady_clock::now();
+
+		s.function(s.context, &frame[i]);
+
+		uint64_t busy = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_point_begin).count();
+		s.busy_ns.fetch_add(busy, std::memory_order_relaxed);
+		if (busy > s.max_ns.load(std::memory_order_relaxed))
+			s.max_ns.store(busy, std::memory_order_relaxed);
+		s.delivered.fetch_add(1, std::memory_order_relaxed);
+
+		Release(&frame[i]);
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef FRAME_FANOUT_HPP
+#define FRAME_FANOUT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "pressure_frame.hpp"
+#include "spsc_queue.hpp"
+#include "wake_signal.hpp"
+
+
+// A frame consumer, e.g. logger, visualiser, controller. The frame is read-only and valid during the call.
+typedef void (*FrameSinkFunction)(void* context, const PressureFrame* frame);
+
+
+// Counters of one sink, see FrameFanout::getStats()
+struct SinkStats
+{
+	const char* name;
+	uint64_t delivered;		// frames handed to the sink
+	uint64_t dropped;		// frames dropped because the sink queue was full
+	double mean_time;		// mean time in the sink function (in seconds)
+	double max_time;		// max time in the sink function (in seconds)
+	int queue_size;			// frames waiting for this sink
+};
+
+
+/**
+* Zero-copy distribution of the frames to several sink threads
+*
+* Frames come from a fixed pool of reference-counted buffers. The producer (acquisition thread) fills a frame
+* taken with Acquire(), then Publish() hands the SAME buffer to every sink : adding a sink adds a pointer push,
+* not a copy. Once published, a frame is immutable. It returns to the pool when the last sink releases it,
+* so a slow sink only holds its own frames ; a sink whose queue is full loses the frame (counted).
+*
+* A sink thread with no frame sleeps until Publish() wakes it up, so an idle sink costs no CPU.
+* A sink may keep a frame after its call (e.g. the visualiser keeps the latest one) with Retain() / Release().
+*/
+class FrameFanout
+{
+public:
+	static const int max_sink = 8;
+	static const int num_frame = 64;	// frames of the pool
+	static const int queue_size = 16;	// frames waiting in front of a sink (power of two)
+
+	FrameFanout();
+	~FrameFanout();
+
+	int AddSink(const char* name, FrameSinkFunction function, void* context);
+
+	bool Start();
+
+	void Stop();
+
+	PressureFrame* Acquire();
+
+	void Publish(PressureFrame* frame);
+
+	void Retain(const PressureFrame* frame);
+
+	void Release(const PressureFrame* frame);
+
+	int getNumSink() { return num_sink; }
+
+	int getNumFree();
+
+	uint64_t getNumExhausted() { return exhausted.load(std::memory_order_relaxed); }
+
+	void getStats(int sink, SinkStats* stats);
+
+private:
+	struct Sink
+	{
+		const char* name;
+		FrameSinkFunction function;
+		void* context;
+		SPSCQueue<int, queue_size> queue;
+		WakeSignal signal;		// a frame was queued
+
+		std::atomic<uint64_t> delivered;
+		std::atomic<uint64_t> dropped;
+		std::atomic<uint64_t> busy_ns;
+		std::atomic<uint64_t> max_ns;
+	};
+
+	// Reference count of each frame of the pool, on its own cache-line (released by several threads)
+	struct RefCount
+	{
+		alignas(64) std::atomic<int> count;
+	};
+
+	PressureFrame frame[num_frame];
+	RefCount ref_count[num_frame];		// 0 -> free
+	int next_free = 0;					// where Acquire() starts looking (producer only)
+	std::atomic<uint64_t> exhausted;	// Acquire() found no free frame
+
+	Sink sink[max_sink];
+	int num_sink = 0;
+
+	std::thread thread[max_sink];
+	std::atomic<bool> running;
+
+	void RunSink(int index);
+
+	int getIndex(const PressureFrame* frame) { return (int)(frame - this->frame); }
+};
+
+
+#endif // FRAME_FANOUT_HPP
@@ -0,0 +1,160 @@
+#ifndef FRAME_HISTORY_HPP
+#define FRAME_HISTORY_HPP
+
+#include "pressure_frame.hpp"
+
+
+/** Zero-copy view of consecutive frames inside FrameHistory
+*
+* Because the ring wraps, the window is made of up to 2 contiguous spans.
+* Index 0 is the OLDEST frame of the window, size()-1 the newest.
+*/
+struct FrameWindow
+{
+	const PressureFrame* first = 0;
+	int n_first = 0;
+	const PressureFrame* second = 0;
+	int n_second = 0;
+
+	int size() const { return n_first + n_second; }
+
+	const PressureFrame& operator[](int i) const
+	{
+		return (i < n_first) ? first[i] : second[i - n_first];
+	}
+};
+
+
+/**
+* Fixed-capacity history of the most recent frames, shared by all windowed algorithms
+*
+* Append is O(1) and writes the frame in place (no allocation).
+* Frames are read by age (0 -> newest), by sequence number (O(1)) or by time-stamp (binary search),
+* and as windows of the last n frames without copying.
+* The frame buffer starts on a cache-line boundary.
+*
+* @note Capacity must be a power of 2
+*/
+template <int Capacity>
+class FrameHistory
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+	static const int capacity = Capacity;
+
+	void Clear() { total = 0; }
+
+	/** @brief Reserve the next slot, to be filled in place by the caller
+	*
+	* @return returns the slot of the new newest frame
+	*/
+	PressureFrame* Append()
+	{
+		PressureFrame* slot = &frames[total & (Capacity - 1)];
+		total++;
+		return slot;
+	}
+
+	/** @brief Copy a frame as the new newest frame
+	*/
+	void Push(const PressureFrame& frame)
+	{
+		*Append() = frame;
+	}
+
+	int size() const { return (total < (unsigned long)Capacity) ? (int)total : Capacity; }
+
+	/** @brief Frame by age
+	*
+	* @param[in] age 0 -> newest ; size()-1 -> oldest
+	*/
+	const PressureFrame& at(int age) const
+	{
+		return frames[(total - 1 - age) & (Capacity - 1)];
+	}
+
+	const PressureFrame& newest() const { return at(0); }
+
+	/** @brief Age of the frame with a given sequence number
+	*
+	* Sequence numbers of consecutive appends must be consecutive.
+	*
+	* @return returns the age, or -1 if the frame is not (or no longer) in the history
+	*/
+	int FindBySeq(uint32_t seq) const
+	{
+		if (total == 0)
+			return -1;
+		uint32_t age = newest().seq - seq;
+		if (age >= (uint32_t)size())
+			return -1;
+		return (int)age;
+	}
+
+	/** @brief Age of the newest frame taken at or before a time-stamp (binary search)
+	*
+	* @return returns the age, or -1 if all frames are newer than time_stamp
+	*/
+	int FindByTime(double time_stamp) const
+	{
+		int lo = 0, hi = size() - 1;	// ages, time decreases with age
+		if (hi < 0 || at(hi).time_stamp > time_stamp)
+			return -1;
+		while (lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if (at(mid).time_stamp <= time_stamp)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return lo;
+	}
+
+	/** @brief View of the last n frames (clipped to size()), oldest first, without copying
+	*/
+	FrameWindow getWindow(int n) const
+	{
+		FrameWindow window;
+		if (n > size())
+			n = size();
+		if (n <= 0)
+			return window;
+
+		int begin = (int)((total - n) & (Capacity - 1));
+		if (begin + n <= Capacity)
+		{
+			window.first = &frames[begin];
+			window.n_first = n;
+		}
+		else
+		{
+			window.first = &frames[begin];
+			window.n_first = Capacity - begin;
+			window.second = &frames[0];
+			window.n_second = n - window.n_first;
+		}
+		return window;
+	}
+
+	/** @brief View of all frames taken since a time-stamp (inclusive)
+	*/
+	FrameWindow getWindowSince(double time_stamp) const
+	{
+		int n = 0;
+		int age = FindByTime(time_stamp);
+		if (age < 0)
+			n = size();
+		else
+			n = (at(age).time_stamp == time_stamp) ? age + 1 : age;
+		return getWindow(n);
+	}
+
+private:
+	alignas(64) PressureFrame frames[Capacity];
+	unsigned long total = 0;	// frames appended since Clear()
+};
+
+
+#endif // FRAME_HISTORY_HPP
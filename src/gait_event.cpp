@@ -0,0 +1,134 @@
+#include <cstddef>
+
+#include "gait_event.hpp"
+
+
+// Clamp a confidence term into [0, 1]
+static float Clamp01(float x)
+{
+	if (x < 0)
+		return 0;
+	if (x > 1)
+		return 1;
+	return x;
+}
+
+
+/*
+@brief	Set the thresholds and reset the state machine to Swing
+
+@param[in]	foot	1 -> left ; 2 -> right
+@param[in]	config	thresholds of the state machine
+*/
+void GaitEventDetector::Init(int foot, const GaitEventConfig& config)
+{
+	this->foot = foot;
+	this->config = config;
+
+	phase = kSwing;
+	reference_load = config.init_reference;
+	stance_peak = 0;
+	heel_peak = 0;
+	cop_strike = 0;
+	for (int i = 0; i < 5; i++)
+		last_event_time[i] = 0;
+}
+
+
+/*
+@brief	Store the event into the record and move to the next phase
+*/
+GaitEvent GaitEventDetector::Emit(GaitEvent event, GaitPhase next_phase, float confidence, double time_stamp, GaitEventRecord* record)
+{
+	phase = next_phase;
+	last_event_time[event] = time_stamp;
+
+	if (record != NULL)
+	{
+		record->event = event;
+		record->foot = foot;
+		record->time_stamp = time_stamp;
+		record->confidence = Clamp01(confidence);
+	}
+	return event;
+}
+
+
+/*
+@brief	Advance the state machine by one frame
+
+@param[in]	heel_load		pressure-sum of the heel region
+@param[in]	forefoot_load	pressure-sum of the forefoot region
+@param[in]	total_load		pressure-sum of the whole foot
+@param[in]	cop_toe			COP along the foot, increasing towards the toes (in pixels)
+@param[in]	time_stamp		time-stamp of the current frame (in seconds)
+@param[out]	record			the detected event (untouched if no event)
+
+@return 	the detected event, kNoEvent if the phase did not change
+*/
+GaitEvent GaitEventDetector::Update(float heel_load, float forefoot_load, float total_load, float cop_toe, double time_stamp, GaitEventRecord* record)
+{
+	// Toe-off can happen from any stance phase
+	if (phase != kSwing)
+	{
+		if (total_load > stance_peak)
+			stance_peak = total_load;
+		if (heel_load > heel_peak)
+			heel_peak = heel_load;
+
+		if (total_load < config.contact_off)
+		{
+			if (stance_peak > config.contact_on)
+				reference_load = stance_peak;
+
+			float stance_time = float(time_stamp - last_event_time[kHeelStrike]);
+			float confidence = 1.0f - total_load / config.contact_off;
+			if (stance_time < config.min_stance)
+				confidence *= 0.5f;
+			if (phase != kPushOff)
+				confidence *= 0.5f;		// heel-off was never seen in this stance
+			return Emit(kToeOff, kSwing, confidence, time_stamp, record);
+		}
+	}
+
+	switch (phase)
+	{
+	case kSwing:
+		if (total_load > config.contact_on)
+		{
+			stance_peak = total_load;
+			heel_peak = heel_load;
+			cop_strike = cop_toe;
+
+			// A clear heel-strike loads the heel first ; a forefoot landing still counts, but with low confidence
+			float heel_share = heel_load / total_load;
+			float confidence = heel_share * Clamp01(total_load / (2 * config.contact_on));
+			return Emit(kHeelStrike, kLoading, confidence, time_stamp, record);
+		}
+		break;
+
+	case kLoading:
+		if (forefoot_load > config.forefoot_on * reference_load)
+		{
+			float confidence = Clamp01(forefoot_load / (2 * config.forefoot_on * reference_load))
+				* Clamp01(2 * heel_load / (heel_peak + 1));
+			return Emit(kFootFlat, kMidStance, confidence, time_stamp, record);
+		}
+		break;
+
+	case kMidStance:
+		if (heel_load < config.heel_off * heel_peak)
+		{
+			// The COP must have travelled towards the toes since heel-strike
+			float confidence = Clamp01((cop_toe - cop_strike) / config.cop_progression)
+				* Clamp01(forefoot_load / (config.forefoot_on * reference_load));
+			return Emit(kHeelOff, kPushOff, confidence, time_stamp, record);
+		}
+		break;
+
+	case kPushOff:
+		break;
+	}
+
+	return kNoEvent;
+}
@@ -0,0 +1,88 @@
+#ifndef GAIT_EVENT_HPP
+#define GAIT_EVENT_HPP
+
+
+/** Gait events emitted by GaitEventDetector, in the order they happen within one step
+*/
+enum GaitEvent
+{
+	kNoEvent = 0,
+	kHeelStrike = 1,
+	kFootFlat = 2,
+	kHeelOff = 3,
+	kToeOff = 4
+};
+
+/** Gait phase of one foot, i.e. the state between 2 gait events
+*/
+enum GaitPhase
+{
+	kSwing = 0,			// toe-off		-> heel-strike
+	kLoading = 1,		// heel-strike	-> foot-flat
+	kMidStance = 2,		// foot-flat	-> heel-off
+	kPushOff = 3		// heel-off		-> toe-off
+};
+
+/** One detected gait event
+*/
+struct GaitEventRecord
+{
+	GaitEvent event = kNoEvent;
+	int foot = 0;				// same as heel_strike : 1 -> left ; 2 -> right
+	double time_stamp = 0;		// time-stamp of the frame that triggered the event (in seconds)
+	float confidence = 0;		// 0 -> weak evidence ; 1 -> clear evidence
+};
+
+/** Thresholds of the gait event state machine
+*
+* Absolute thresholds are in the unit of the pressure-sum.
+* Relative thresholds are fractions of the reference load, which is the peak pressure-sum of the previous stance.
+*/
+struct GaitEventConfig
+{
+	float contact_on = 3000;		// pressure-sum to detect initial contact
+	float contact_off = 1500;		// pressure-sum to detect toe-off (hysteresis below contact_on)
+	float forefoot_on = 0.15f;		// forefoot load / reference load to detect foot-flat
+	float heel_off = 0.10f;			// heel load / heel peak of this stance to detect heel-off
+	float cop_progression = 3.0f;	// expected COP travel (in pixels) from heel-strike to heel-off
+	float min_stance = 0.2f;		// stance shorter than this (in seconds) lowers the toe-off confidence
+	float init_reference = 20000;	// reference load before the first stance is completed
+};
+
+
+/**
+* Incremental gait event state machine of one foot
+*
+* Swing -> [heel-strike] -> Loading -> [foot-flat] -> MidStance -> [heel-off] -> PushOff -> [toe-off] -> Swing
+*
+* Each call of Update() handles one frame in constant time, using the heel & forefoot loads and the COP along the foot.
+* Phases can be skipped (e.g. toe-off straight from Loading), then only the latest event is emitted.
+*/
+class GaitEventDetector
+{
+public:
+	void Init(int foot, const GaitEventConfig& config);
+
+	GaitEvent Update(float heel_load, float forefoot_load, float total_load, float cop_toe, double time_stamp, GaitEventRecord* record);
+
+	GaitPhase getPhase() { return phase; }
+
+	double getLastEventTime(GaitEvent event) { return last_event_time[event]; }
+
+private:
+	GaitEventConfig config;
+	int foot = 0;
+
+	GaitPhase phase = kSwing;
+	double last_event_time[5] = { 0, 0, 0, 0, 0 };
+
+	float reference_load = 0;	// peak pressure-sum of the previous stance
+	float stance_peak = 0;		// peak pressure-sum of the current stance
+	float heel_peak = 0;		// peak heel load of the current stance
+	float cop_strike = 0;		// COP (towards toes) at heel-strike
+
+	GaitEvent Emit(GaitEvent event, GaitPhase next_phase, float confidence, double time_stamp, GaitEventRecord* record);
+};
+
+
+#endif // GAIT_EVENT_HPP
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "gait_event_bus.hpp"
+
+
+static int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+GaitEventBus::GaitEventBus()
+{
+	for (int i = 0; i < max_subscriber; i++)
+	{
+		subscriber[i].active = false;
+		subscriber[i].waiting = false;
+	}
+}
+
+
+/*
+@brief	Subscribe a callback, called on the publisher thread for every event of event_mask
+
+@return	id of the subscriber, -1 if full
+*/
+int GaitEventBus::SubscribeCallback(GaitEventCallback callback, void* context, unsigned event_mask)
+{
+	return AddSubscriber(callback, context, event_mask);
+}
+
+
+/*
+@brief	Subscribe a queue, read from ONE consumer thread with Poll() or Wait()
+
+@return	id of the subscriber, -1 if full
+*/
+int GaitEventBus::SubscribeQueue(unsigned event_mask)
+{
+	return AddSubscriber(0, 0, event_mask);
+}
+
+
+/*
+@brief	Stop delivering to a subscriber (its id is not reused)
+*/
+void GaitEventBus::Unsubscribe(int subscriber_id)
+{
+	if (subscriber_id >= 0 && subscriber_id < num_subscriber)
+		subscriber[subscriber_id].active = false;
+}
+
+
+/*
+@brief	Deliver one event to all subscribers of this event
+
+@param[in]	record		the detected event
+@param[in]	frame_seq	sequence number of the frame that triggered it
+*/
+void GaitEventBus::Publish(const GaitEventRecord& record, uint32_t frame_seq)
+{
+	GaitEventMessage message;
+	message.record = record;
+	message.frame_seq = frame_seq;
+	message.seq = ++seq;
+	message.publish_ns = NowNs();
+
+	unsigned bit = EventBit(record.event);
+	for (int i = 0; i < num_subscriber; i++)
+	{
+		Subscriber& s = subscriber[i];
+		if (!s.active.load(std::memory_order_acquire) || !(s.event_mask & bit))
+			continue;
+
+		if (s.callback)
+		{
+			// Delivered once the callback returns : includes the subscribers called before it & its own reaction
+			s.callback(s.context, message);
+			Account(&s, message.publish_ns);
+		}
+		else if (!s.queue.Push(message))
+			s.dropped.fetch_add(1, std::memory_order_relaxed);
+		else
+		{
+			// Only touch the mutex when the consumer sleeps (the fence pairs with the one in Wait())
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (s.waiting.load(std::memory_order_relaxed))
+			{
+				std::lock_guard<std::mutex> lock(s.mutex);
+				s.condition.notify_one();
+			}
+		}
+	}
+}
+
+
+/*
+@brief	Take the next event of a queue subscriber, without waiting
+
+@return	false if no event is pending
+*/
+bool GaitEventBus::Poll(int subscriber_id, GaitEventMessage* message)
+{
+	Subscriber& s = subscriber[subscriber_id];
+	if (!s.queue.Pop(message))
+		return false;
+
+	Account(&s, message->publish_ns);
+	return true;
+}
+
+
+/*
+@brief	Wait for the next event of a queue subscriber
+Spins briefly (no syscall, lowest wake-up latency), then sleeps until Publish() wakes it up.
+
+@param[in]	timeout		maximum waiting time (in seconds)
+@return	false on time-out
+*/
+bool GaitEventBus::Wait(int subscriber_id, GaitEventMessage* message, double timeout)
+{
+	const int64_t spin_ns = 50000;
+	Subscriber& s = subscriber[subscriber_id];
+
+	int64_t start_ns = NowNs();
+	int64_t timeout_ns = int64_t(timeout * 1e9);
+	while (NowNs() - start_ns < std::min(spin_ns, timeout_ns))
+	{
+		if (Poll(subscriber_id, message))
+			return true;
+	}
+
+	std::unique_lock<std::mutex> lock(s.mutex);
+	s.waiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool ready = false;
+	while (!(ready = s.queue.Pop(message)))
+	{
+		int64_t left_ns = timeout_ns - (NowNs() - start_ns);
+		if (left_ns <= 0)
+			break;
+		s.condition.wait_for(lock, std::chrono::nanoseconds(left_ns));
+	}
+	s.waiting.store(false, std::memory_order_relaxed);
+
+	if (ready)
+		Account(&s, message->publish_ns);
+	return ready;
+}
+
+
+/*
+@brief	Get the delivery latency of a subscriber
+*/
+void GaitEventBus::getLatency(int subscriber_id, GaitEventLatency* latency)
+{
+	const Subscriber& s = subscriber[subscriber_id];
+	latency->delivered = s.delivered.load(std::memory_order_relaxed);
+	latency->dropped = s.dropped.load(std::memory_order_relaxed);
+	latency->over_bound = s.over_bound.load(std::memory_order_relaxed);
+	latency->mean = (latency->delivered > 0) ? 1e-9 * s.total_ns.load(std::memory_order_relaxed) / latency->delivered : 0;
+	latency->max = 1e-9 * s.max_ns.load(std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Register a subscriber
+This is an internal function.
+*/
+int GaitEventBus::AddSubscriber(GaitEventCallback callback, void* context, unsigned event_mask)
+{
+	if (num_subscriber >= max_subscriber)
+	{
+		std::cerr << "GaitEventBus: too many subscribers" << std::endl;
+		return -1;
+	}
+
+	Subscriber& s = subscriber[num_subscriber];
+	s.event_mask = event_mask;
+	s.callback = callback;
+	s.context = context;
+	s.queue.Clear();
+	s.delivered = 0;
+	s.dropped = 0;
+	s.over_bound = 0;
+	s.total_ns = 0;
+	s.max_ns = 0;
+	s.active.store(true, std::memory_order_release);
+	return num_subscriber++;
+}
+
+
+/*
+@brief	Count one delivery & its latency
+This is an internal function.
+*/
+void GaitEventBus::Account(Subscriber* s, int64_t publish_ns)
+{
+	int64_t latency = NowNs() - publish_ns;
+	s->delivered.fetch_add(1, std::memory_order_relaxed);
+	s->total_ns.fetch_add(latency, std::memory_order_relaxed);
+	if (latency > s->max_ns.load(std::memory_order_relaxed))
+		s->max_ns.store(latency, std::memory_order_relaxed);
+	if (latency > latency_bound_ns)
+		s->over_bound.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#ifndef GAIT_EVENT_BUS_HPP
+#define GAIT_EVENT_BUS_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "gait_event.hpp"
+#include "spsc_queue.hpp"
+
+
+// A gait event as delivered to the subscribers
+struct GaitEventMessage
+{
+	GaitEventRecord record;		// event, foot, frame time-stamp & confidence
+	uint32_t frame_seq = 0;		// sequence number of the frame that triggered it (PressureData::frame_seq)
+	uint64_t seq = 0;			// sequence number on the bus, +1 per published event (gaps -> dropped by a queue)
+	int64_t publish_ns = 0;		// steady_clock time of publication, for the latency
+};
+
+
+// Called on the publisher thread, right when the event is published : keep it short
+typedef void (*GaitEventCallback)(void* context, const GaitEventMessage& message);
+
+
+// Delivery latency of one subscriber (publication -> its callback / Poll() / Wait() returns)
+struct GaitEventLatency
+{
+	uint64_t delivered = 0;
+	uint64_t dropped = 0;		// queue full
+	uint64_t over_bound = 0;	// delivered later than the latency bound
+	double mean = 0;			// in seconds
+	double max = 0;
+};
+
+
+/**
+* In-process publish / subscribe of gait events
+*
+* Producers (e.g. FootSensor::getGaitEvents(), see FootSensor::setEventBus()) publish every event once ;
+* subscribers react immediately instead of polling a return value at loop rate :
+*	- callback subscribers are called synchronously on the publisher thread (lowest latency),
+*	- queue subscribers get a lock-free SPSC queue they Poll() or Wait() on from their own thread.
+*
+* An event mask selects the events of a subscriber. Publish() must always be called from the same thread,
+* and subscriptions are made before publishing starts.
+*/
+class GaitEventBus
+{
+public:
+	static const int max_subscriber = 16;
+	static const int queue_size = 64;
+
+	GaitEventBus();
+
+	int SubscribeCallback(GaitEventCallback callback, void* context, unsigned event_mask = kAllEvents);
+
+	int SubscribeQueue(unsigned event_mask = kAllEvents);
+
+	void Unsubscribe(int subscriber_id);
+
+	void Publish(const GaitEventRecord& record, uint32_t frame_seq);
+
+	bool Poll(int subscriber_id, GaitEventMessage* message);
+
+	bool Wait(int subscriber_id, GaitEventMessage* message, double timeout);
+
+	void setLatencyBound(double bound) { latency_bound_ns = int64_t(bound * 1e9); }
+
+	void getLatency(int subscriber_id, GaitEventLatency* latency);
+
+	// Bit of an event in an event mask
+	static unsigned EventBit(GaitEvent event) { return 1u << event; }
+	static const unsigned kAllEvents = 0x1E;	// heel-strike, foot-flat, heel-off & toe-off
+
+private:
+	struct Subscriber
+	{
+		std::atomic<bool> active;
+		unsigned event_mask = 0;
+		GaitEventCallback callback = 0;
+		void* context = 0;
+
+		SPSCQueue<GaitEventMessage, queue_size> queue;
+		std::atomic<bool> waiting;		// consumer is (about to be) asleep in Wait()
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		std::atomic<uint64_t> delivered;
+		std::atomic<uint64_t> dropped;
+		std::atomic<uint64_t> over_bound;
+		std::atomic<int64_t> total_ns;
+		std::atomic<int64_t> max_ns;
+	};
+
+	Subscriber subscriber[max_subscriber];
+	int num_subscriber = 0;
+	uint64_t seq = 0;
+	int64_t latency_bound_ns = 1000000;		// 1 ms
+
+	int AddSubscriber(GaitEventCallback callback, void* context, unsigned event_mask);
+
+	void Account(Subscriber* s, int64_t publish_ns);
+};
+
+
+#endif // GAIT_EVENT_BUS_HPP
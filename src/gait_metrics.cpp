@@ -0,0 +1,178 @@
+#include <cmath>
+
+#include "gait_metrics.hpp"
+
+
+// Symmetry index in percent, 0 if both are 0
+static float SymmetryIndex(float left, float right)
+{
+	float mean = 0.5f * (left + right);
+	if (mean <= 0)
+		return 0;
+	return 100.0f * std::fabs(left - right) / mean;
+}
+
+
+/*
+@brief	Clear all strides and set the size of the rolling window
+
+@param[in]	window	number of most recent strides per foot used by getSummary() (1 .. capacity)
+*/
+void GaitMetrics::Init(int window)
+{
+	if (window < 1)
+		window = 1;
+	if (window > capacity)
+		window = capacity;
+	this->window = window;
+
+	for (int k = 0; k < 2; k++)
+	{
+		head[k] = 0;
+		count[k] = 0;
+		total_stride[k] = 0;
+		sum_stride[k] = 0;
+		sum_stance[k] = 0;
+		sum_swing[k] = 0;
+		last_heel_strike[k] = -1;
+		last_toe_off[k] = -1;
+	}
+}
+
+
+/*
+@brief	Store a completed stride & update the running sums of the window
+*/
+void GaitMetrics::AddStride(int k, const StrideRecord& stride)
+{
+	// The stride that leaves the window is "window" strides behind the new one
+	if (count[k] >= window)
+	{
+		const StrideRecord& old = ring[k][(head[k] - window + capacity) % capacity];
+		sum_stride[k] -= old.stride_time;
+		sum_stance[k] -= old.stance_time;
+		sum_swing[k] -= old.swing_time;
+	}
+
+	ring[k][head[k]] = stride;
+	head[k] = (head[k] + 1) % capacity;
+	if (count[k] < capacity)
+		count[k]++;
+	total_stride[k]++;
+
+	sum_stride[k] += stride.stride_time;
+	sum_stance[k] += stride.stance_time;
+	sum_swing[k] += stride.swing_time;
+}
+
+
+/*
+@brief	Feed the gait events of the current frame
+
+A stride of a foot is completed at its heel-strike, if the previous heel-strike & the toe-off in between were seen.
+
+@param[in]	events		gait events of the current frame (from FootSensor::getGaitEvents)
+@param[in]	num_event	number of events in events[]
+
+@return	number of strides completed by these events
+*/
+int GaitMetrics::Update(const GaitEventRecord* events, int num_event)
+{
+	int num_complete = 0;
+
+	for (int i = 0; i < num_event; i++)
+	{
+		int k = events[i].foot - 1;
+		if (k < 0 || k > 1)
+			continue;
+
+		if (events[i].event == kToeOff)
+		{
+			if (last_heel_strike[k] >= 0)
+				last_toe_off[k] = events[i].time_stamp;
+		}
+		else if (events[i].event == kHeelStrike)
+		{
+			double heel_strike = events[i].time_stamp;
+			if (last_heel_strike[k] >= 0 && last_toe_off[k] >= last_heel_strike[k])
+			{
+				StrideRecord stride;
+				stride.foot = k + 1;
+				stride.heel_strike = last_heel_strike[k];
+				stride.toe_off = last_toe_off[k];
+				stride.stride_time = float(heel_strike - last_heel_strike[k]);
+				stride.stance_time = float(last_toe_off[k] - last_heel_strike[k]);
+				stride.swing_time = float(heel_strike - last_toe_off[k]);
+				AddStride(k, stride);
+				num_complete++;
+			}
+			last_heel_strike[k] = heel_strike;
+			last_toe_off[k] = -1;
+		}
+	}
+
+	return num_complete;
+}
+
+
+/*
+@brief	Rolling summary over the last strides of each foot, in O(1)
+
+@param[out]	summary		cadence, mean stride/stance/swing times and left/right asymmetry
+*/
+void GaitMetrics::getSummary(GaitSummary* summary)
+{
+	*summary = GaitSummary();
+
+	for (int k = 0; k < 2; k++)
+	{
+		int n = (count[k] < window) ? count[k] : window;
+		summary->num_stride[k] = n;
+		if (n == 0)
+			continue;
+
+		summary->stride_time[k] = float(sum_stride[k] / n);
+		summary->stance_time[k] = float(sum_stance[k] / n);
+		summary->swing_time[k] = float(sum_swing[k] / n);
+		if (summary->stride_time[k] > 0)
+		{
+			summary->stance_percent[k] = 100.0f * summary->stance_time[k] / summary->stride_time[k];
+			summary->cadence += 60.0f / summary->stride_time[k];	// 1 step of this foot per stride
+		}
+	}
+
+	if (summary->num_stride[0] > 0 && summary->num_stride[1] > 0)
+	{
+		summary->stride_asymmetry = SymmetryIndex(summary->stride_time[0], summary->stride_time[1]);
+		summary->stance_asymmetry = SymmetryIndex(summary->stance_time[0], summary->stance_time[1]);
+		summary->swing_asymmetry = SymmetryIndex(summary->swing_time[0], summary->swing_time[1]);
+	}
+	else
+	{
+		summary->cadence *= 2;	// only one foot seen so far : assume the other foot steps as often
+	}
+}
+
+
+/*
+@brief	Number of strides of one foot available in the ring
+
+@param[in]	foot	1 -> left ; 2 -> right
+*/
+int GaitMetrics::getNumStride(int foot)
+{
+	return count[foot - 1];
+}
+
+
+/*
+@brief	Access a stored stride of one foot
+
+@param[in]	foot	1 -> left ; 2 -> right
+@param[in]	index	0 -> most recent stride ; getNumStride()-1 -> oldest stride in the ring
+*/
+const StrideRecord& GaitMetrics::getStride(int foot, int index)
+{
+	int k = foot - 1;
+	return ring[k][(head[k] - 1 - index + 2 * capacity) % capacity];
+}
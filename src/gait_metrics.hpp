@@ -0,0 +1,83 @@
+#ifndef GAIT_METRICS_HPP
+#define GAIT_METRICS_HPP
+
+#include "gait_event.hpp"
+
+
+/** Timing of one stride of one foot : heel-strike -> toe-off -> next heel-strike
+*/
+struct StrideRecord
+{
+	int foot = 0;				// 1 -> left ; 2 -> right
+	double heel_strike = 0;		// time-stamp of the heel-strike that starts the stride (in seconds)
+	double toe_off = 0;			// time-stamp of the toe-off
+	float stride_time = 0;		// heel-strike -> next heel-strike
+	float stance_time = 0;		// heel-strike -> toe-off
+	float swing_time = 0;		// toe-off -> next heel-strike
+};
+
+/** Rolling summary over the last strides of each foot
+*
+* Arrays are indexed by foot : [0] -> left ; [1] -> right
+* Asymmetry is the symmetry index 100 * |L - R| / mean(L, R), in percent (0 -> perfectly symmetric)
+*/
+struct GaitSummary
+{
+	int num_stride[2] = { 0, 0 };		// strides inside the rolling window
+	float cadence = 0;					// steps per minute (both feet)
+	float stride_time[2] = { 0, 0 };	// mean, in seconds
+	float stance_time[2] = { 0, 0 };
+	float swing_time[2] = { 0, 0 };
+	float stance_percent[2] = { 0, 0 };	// stance / stride, in percent
+	float stride_asymmetry = 0;
+	float stance_asymmetry = 0;
+	float swing_asymmetry = 0;
+};
+
+
+/**
+* Online gait metrics built on the gait events (heel-strike & toe-off)
+*
+* Completed strides are stored in a fixed-capacity ring per foot.
+* Running sums over the last "window" strides are updated when a stride enters and leaves the window,
+* so getSummary() is O(1) and never rescans the history, even over long treadmill sessions.
+*/
+class GaitMetrics
+{
+public:
+	static const int capacity = 128;	// strides kept per foot
+
+	void Init(int window);
+
+	int Update(const GaitEventRecord* events, int num_event);
+
+	void getSummary(GaitSummary* summary);
+
+	int getNumStride(int foot);
+
+	const StrideRecord& getStride(int foot, int index);
+
+	long getTotalStride(int foot) { return total_stride[foot - 1]; }
+
+private:
+	int window = 10;
+
+	StrideRecord ring[2][capacity];
+	int head[2] = { 0, 0 };			// index of the next stride to write
+	int count[2] = { 0, 0 };		// valid strides in the ring
+	long total_stride[2] = { 0, 0 };
+
+	// Running sums over the last min(count, window) strides
+	double sum_stride[2] = { 0, 0 };
+	double sum_stance[2] = { 0, 0 };
+	double sum_swing[2] = { 0, 0 };
+
+	// Events of the stride in progress
+	double last_heel_strike[2] = { -1, -1 };
+	double last_toe_off[2] = { -1, -1 };
+
+	void AddStride(int k, const StrideRecord& stride);
+};
+
+
+#endif // GAIT_METRICS_HPP
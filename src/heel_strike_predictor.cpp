@@ -0,0 +1,214 @@
+#include <cmath>
+#include <algorithm>
+
+#include "heel_strike_predictor.hpp"
+
+
+/*
+@brief	Set the thresholds and disarm the detector until a full swing is seen
+
+@param[in]	config	thresholds of the single-frame detection
+*/
+void HeelStrikePredictor::Init(const HeelStrikePredictorConfig& config)
+{
+	this->config = config;
+	armed = false;
+	prev_valid = false;
+	swing_start = -1;
+}
+
+
+/*
+@brief	Check the current frame for a heel-strike onset
+
+The detector arms after the foot has been unloaded for min_swing seconds.
+Once armed, the first frame that passes ALL the shape checks fires:
+	- heel load above onset_load, rising faster than onset_rate
+	- heel carries most of the load & enough heel pixels are loaded
+	- COP is not jumping faster than max_cop_speed (electrical glitch)
+	- pressure-sum is not an obvious spike
+A glitch frame is ignored, the detector stays armed.
+A clearly loaded frame that is NOT heel-first (e.g. forefoot landing) disarms until the next swing.
+
+@param[in]	input	measurements of the current frame
+
+@return 	true on the frame of heel-strike
+*/
+bool HeelStrikePredictor::Update(const HeelStrikeInput& input)
+{
+	bool heel_strike = false;
+	float dt = prev_valid ? float(input.time_stamp - prev.time_stamp) : 0;
+
+	if (input.total_load < config.swing_load)
+	{
+		// Swing : arm once the foot has been unloaded long enough
+		if (swing_start < 0)
+			swing_start = input.time_stamp;
+		if (input.time_stamp - swing_start >= config.min_swing)
+			armed = true;
+	}
+	else
+	{
+		swing_start = -1;
+
+		if (armed && dt > 0)
+		{
+			bool glitch = (input.total_load > config.spike_load);
+			if (prev.total_load > 0.5f * config.swing_load)
+			{
+				float cop_speed = std::fabs(input.cop_toe - prev.cop_toe) / dt;
+				glitch = glitch || (cop_speed > config.max_cop_speed);
+			}
+
+			if (!glitch)
+			{
+				float heel_rate = (input.heel_load - prev.heel_load) / dt;
+				float heel_share = input.heel_load / input.total_load;
+
+				if (input.heel_load > config.onset_load
+					&& heel_rate > config.onset_rate
+					&& heel_share > config.min_heel_share
+					&& input.heel_cells >= config.min_heel_cells)
+				{
+					heel_strike = true;
+					armed = false;
+				}
+				else if (input.total_load > 2 * config.onset_load && heel_share < config.min_heel_share)
+				{
+					armed = false;	// landing without heel-strike
+				}
+			}
+		}
+	}
+
+	prev = input;
+	prev_valid = true;
+
+	return heel_strike;
+}
+
+
+/*
+@brief	Find the heel-strikes of a recorded session OFFLINE (non-causal) as ground truth
+
+For every stance that follows a swing of at least min_swing seconds,
+the heel-strike is where the heel load first crosses 10% of the peak heel load of that stance.
+The crossing time is linearly interpolated between the 2 frames around it.
+Stances whose heel never carries swing_load (forefoot landing) have no heel-strike.
+
+@param[in]	session		all frames of one foot, in time order
+@param[in]	swing_load	foot is unloaded below this pressure-sum
+@param[in]	min_swing	minimum swing duration before a heel-strike (in seconds)
+@param[out]	truth		time-stamps of the ground truth heel-strikes
+*/
+void HeelStrikePredictor::FindGroundTruth(const std::vector<HeelStrikeInput>& session, float swing_load, float min_swing, std::vector<double>* truth)
+{
+	truth->clear();
+
+	const int n = (int)session.size();
+	double swing_start = -1;
+	int i = 0;
+
+	while (i < n)
+	{
+		if (session[i].total_load < swing_load)
+		{
+			if (swing_start < 0)
+				swing_start = session[i].time_stamp;
+			i++;
+			continue;
+		}
+
+		// Stance from i to stance_end (exclusive)
+		int stance_begin = i;
+		int stance_end = i;
+		float heel_peak = 0;
+		while (stance_end < n && session[stance_end].total_load >= swing_load)
+		{
+			heel_peak = std::max(heel_peak, session[stance_end].heel_load);
+			stance_end++;
+		}
+
+		bool after_swing = (swing_start >= 0) && (session[stance_begin].time_stamp - swing_start >= min_swing);
+		if (after_swing && heel_peak >= swing_load)
+		{
+			float threshold = 0.1f * heel_peak;
+			for (int k = std::max(stance_begin - 1, 0); k < stance_end; k++)
+			{
+				if (session[k].heel_load >= threshold)
+				{
+					double t = session[k].time_stamp;
+					if (k > 0 && session[k].heel_load > session[k - 1].heel_load)
+					{
+						double ratio = (threshold - session[k - 1].heel_load) / (session[k].heel_load - session[k - 1].heel_load);
+						t = session[k - 1].time_stamp + std::max(ratio, 0.0) * (session[k].time_stamp - session[k - 1].time_stamp);
+					}
+					truth->push_back(t);
+					break;
+				}
+			}
+		}
+
+		swing_start = -1;
+		i = stance_end;
+	}
+}
+
+
+/*
+@brief	Match detections to ground truth heel-strikes and measure the detection latency
+
+Each ground truth heel-strike is matched to the nearest unmatched detection within +/- max_latency.
+Latency = detection time - ground truth time (negative if the detection is early).
+
+@param[in]	detected		time-stamps of the online detections
+@param[in]	truth			time-stamps of the ground truth (from FindGroundTruth)
+@param[in]	max_latency		matching window (in seconds)
+@param[out]	report			counts and latency statistics
+*/
+void HeelStrikePredictor::CompareToGroundTruth(const std::vector<double>& detected, const std::vector<double>& truth, float max_latency, HeelStrikeLatencyReport* report)
+{
+	*report = HeelStrikeLatencyReport();
+	report->num_truth = (int)truth.size();
+
+	std::vector<bool> used(detected.size(), false);
+	std::vector<float> latency;
+
+	for (size_t t = 0; t < truth.size(); t++)
+	{
+		int best = -1;
+		double best_dist = max_latency;
+		for (size_t d = 0; d < detected.size(); d++)
+		{
+			double dist = std::fabs(detected[d] - truth[t]);
+			if (!used[d] && dist <= best_dist)
+			{
+				best = (int)d;
+				best_dist = dist;
+			}
+		}
+
+		if (best < 0)
+		{
+			report->num_missed++;
+			continue;
+		}
+		used[best] = true;
+		latency.push_back(float(detected[best] - truth[t]));
+	}
+
+	report->num_detected = (int)latency.size();
+	report->num_false = (int)detected.size() - report->num_detected;
+
+	if (latency.empty())
+		return;
+
+	float sum = 0;
+	for (size_t k = 0; k < latency.size(); k++)
+		sum += latency[k];
+	report->mean_latency = sum / latency.size();
+
+	std::sort(latency.begin(), latency.end());
+	report->max_latency = latency.back();
+	report->p95_latency = latency[(size_t)(0.95 * (latency.size() - 1))];
+}
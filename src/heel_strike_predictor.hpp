@@ -0,0 +1,79 @@
+#ifndef HEEL_STRIKE_PREDICTOR_HPP
+#define HEEL_STRIKE_PREDICTOR_HPP
+
+#include <vector>
+
+
+/** Per-frame measurements of one foot used by HeelStrikePredictor
+*/
+struct HeelStrikeInput
+{
+	float heel_load = 0;		// pressure-sum of the heel region
+	int heel_cells = 0;			// number of loaded pixels in the heel region
+	float total_load = 0;		// pressure-sum of the whole foot
+	float cop_toe = 0;			// COP along the foot, increasing towards the toes (in pixels)
+	double time_stamp = 0;		// in seconds
+};
+
+/** Thresholds of the single-frame heel-strike detection
+*
+* Loads are in the unit of the pressure-sum.
+*/
+struct HeelStrikePredictorConfig
+{
+	float swing_load = 1500;		// foot is unloaded (swing) below this pressure-sum
+	float min_swing = 0.15f;		// swing must last this long (in seconds) before arming
+	float onset_load = 2000;		// heel load to detect the onset
+	float onset_rate = 20000;		// heel load rate (per second) to detect the onset
+	float min_heel_share = 0.6f;	// heel load / total load at the onset
+	int min_heel_cells = 2;			// loaded pixels in the heel region (rejects single-pixel spikes)
+	float max_cop_speed = 150;		// COP speed (pixels per second) above which the reading is a glitch
+	float spike_load = 2000000;		// pressure-sum that can only be an electrical spike
+};
+
+/** Measured latency of the predictive heel-strike against the offline ground truth
+*/
+struct HeelStrikeLatencyReport
+{
+	int num_truth = 0;			// heel-strikes in the ground truth
+	int num_detected = 0;		// ground truth heel-strikes matched by a detection
+	int num_missed = 0;			// ground truth heel-strikes without detection
+	int num_false = 0;			// detections without ground truth heel-strike
+	float mean_latency = 0;		// in seconds
+	float max_latency = 0;		// in seconds
+	float p95_latency = 0;		// in seconds
+};
+
+
+/**
+* Heel-strike detection that fires on the FIRST qualifying frame
+*
+* getHeelStrike() waits for 2 consecutive frames of pressure-gradiant above threshold.
+* Here false-positives are rejected from the shape of the signal instead of waiting:
+* the load must start in the heel (heel share & number of heel pixels), rise fast,
+* follow a long enough swing, and the COP must not jump like an electrical glitch.
+*/
+class HeelStrikePredictor
+{
+public:
+	void Init(const HeelStrikePredictorConfig& config);
+
+	bool Update(const HeelStrikeInput& input);
+
+	bool isArmed() { return armed; }
+
+	static void FindGroundTruth(const std::vector<HeelStrikeInput>& session, float swing_load, float min_swing, std::vector<double>* truth);
+
+	static void CompareToGroundTruth(const std::vector<double>& detected, const std::vector<double>& truth, float max_latency, HeelStrikeLatencyReport* report);
+
+private:
+	HeelStrikePredictorConfig config;
+
+	bool armed = false;				// swing long enough, waiting for the heel-strike
+	bool prev_valid = false;		// previous frame exists
+	double swing_start = -1;		// time-stamp when the foot was unloaded (-1 -> loaded)
+	HeelStrikeInput prev;			// previous frame
+};
+
+
+#endif // HEEL_STRIKE_PREDICTOR_HPP
@@ -0,0 +1,219 @@
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "loop_scheduler.hpp"
+
+
+LoopScheduler::LoopScheduler()
+{
+}
+
+
+LoopScheduler::~LoopScheduler()
+{
+	Stop();
+}
+
+
+/*
+@brief	Start the periods, the 1st deadline is one period from now. Counters are reset.
+
+@param[in]	rate_hz			loop rate
+@param[in]	late_tolerance	wake-ups later than this fraction of the period are counted as late
+@return	false if the rate is not valid or the timer cannot be created
+*/
+bool LoopScheduler::Start(double rate_hz, double late_tolerance)
+{
+	Stop();
+	if (rate_hz <= 0)
+		return false;
+
+	period = 1.0 / rate_hz;
+	this->late_tolerance = late_tolerance * period;
+	stats = LoopStats();
+	total_late = 0;
+	total_cycle = 0;
+	next_period = 1;
+
+#if defined(__linux__)
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if (timer_fd < 0)
+	{
+		std::cerr << "LoopScheduler: timerfd_create failed (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+
+	itimerspec spec;
+	long period_ns = long(period * 1e9);
+	spec.it_interval.tv_sec = period_ns / 1000000000L;
+	spec.it_interval.tv_nsec = period_ns % 1000000000L;
+	spec.it_value = spec.it_interval;
+
+	time_point_start = std::chrono::steady_clock::now();	// steady_clock is CLOCK_MONOTONIC
+	if (timerfd_settime(timer_fd, 0, &spec, NULL) != 0)
+	{
+		std::cerr << "LoopScheduler: timerfd_settime failed (" << strerror(errno) << ")" << std::endl;
+		Stop();
+		return false;
+	}
+	expired = 0;
+#else
+	time_point_start = std::chrono::steady_clock::now();
+#endif
+
+	time_point_cycle = time_point_start;
+	running = true;
+	return true;
+}
+
+
+/*
+@brief	Stop the periods & release the timer
+*/
+void LoopScheduler::Stop()
+{
+#if defined(__linux__)
+	if (timer_fd >= 0)
+		close(timer_fd);
+	timer_fd = -1;
+#endif
+	running = false;
+}
+
+
+/*
+@brief	Run lower-priority work in the slack of each period (e.g. printing or saving)
+
+@param[in]	function	called repeatedly by Wait() while it returns true and the deadline is far enough
+@param[in]	context		object passed to function
+@param[in]	margin		fraction of the period kept free before the deadline
+*/
+void LoopScheduler::setSlackWork(SlackFunction function, void* context, double margin)
+{
+	slack_function = function;
+	slack_context = context;
+	slack_margin = margin;
+}
+
+
+/*
+@brief	End of the cycle : run slack work, then sleep until the next period
+After an overrun, the missed periods are skipped : Wait() sleeps until the next future deadline.
+
+@return	number of periods missed since the previous cycle (0 on time)
+*/
+int LoopScheduler::Wait()
+{
+	if (!running)
+		return 0;
+
+	auto time_point_now = std::chrono::steady_clock::now();
+	if (stats.num_cycle > 0)
+	{
+		double cycle = std::chrono::duration<double>(time_point_now - time_point_cycle).count();
+		total_cycle += cycle;
+		if (cycle > stats.max_cycle)
+			stats.max_cycle = cycle;
+	}
+
+	RunSlack();
+
+	// Deadline to wake up at : the planned one, or the next future one after an overrun
+	time_point_now = std::chrono::steady_clock::now();
+	uint64_t wake = next_period;
+	if (time_point_now >= getDeadline(next_period))
+	{
+		uint64_t due = uint64_t(std::chrono::duration<double>(time_point_now - time_point_start).count() / period);
+		wake = due + 1;
+	}
+
+#if defined(__linux__)
+	while (expired < wake)
+	{
+		uint64_t count;
+		ssize_t n = read(timer_fd, &count, sizeof(count));
+		if (n == sizeof(count))
+			expired += count;
+		else if (n < 0 && errno != EINTR)
+		{
+			std::this_thread::sleep_until(getDeadline(wake));
+			expired = wake;
+		}
+	}
+	uint64_t woken = expired;
+#else
+	std::this_thread::sleep_until(getDeadline(wake));
+	uint64_t woken = wake;
+#endif
+
+	time_point_cycle = std::chrono::steady_clock::now();
+
+	// Woken at deadline "woken" : periods between the planned deadline and it were missed
+	int missed = int(woken - next_period);
+	if (missed > 0)
+	{
+		stats.num_overrun++;
+		stats.num_missed += missed;
+	}
+
+	double late = std::chrono::duration<double>(time_point_cycle - getDeadline(woken)).count();
+	total_late += late;
+	if (late > stats.max_late)
+		stats.max_late = late;
+	if (late > late_tolerance)
+		stats.num_late++;
+
+	next_period = woken + 1;
+	stats.num_period = woken;
+	stats.num_cycle++;
+	return missed;
+}
+
+
+/*
+@brief	Get the timing counters
+*/
+void LoopScheduler::getStats(LoopStats* stats)
+{
+	*stats = this->stats;
+	stats->mean_late = (this->stats.num_cycle > 0) ? total_late / this->stats.num_cycle : 0;
+	stats->mean_cycle = (this->stats.num_cycle > 1) ? total_cycle / (this->stats.num_cycle - 1) : 0;
+}
+
+
+/*
+@brief	Time of a deadline
+This is an internal function.
+*/
+std::chrono::time_point<std::chrono::steady_clock> LoopScheduler::getDeadline(uint64_t index)
+{
+	return time_point_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(index * period));
+}
+
+
+/*
+@brief	Call the slack work until it is done or the deadline is near
+This is an internal function.
+*/
+void LoopScheduler::RunSlack()
+{
+	if (slack_function == 0)
+		return;
+
+	auto time_point_limit = getDeadline(next_period) - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(slack_margin * period));
+	while (std::chrono::steady_clock::now() < time_point_limit)
+	{
+		stats.num_slack++;
+		if (!slack_function(slack_context))
+			break;
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef LOOP_SCHEDULER_HPP
+#define LOOP_SCHEDULER_HPP
+
+#include <stdint.h>
+#include <chrono>
+
+
+// Lower-priority work run in the slack of a period (printing, saving, ...) : returns false when nothing is left to do
+typedef bool (*SlackFunction)(void* context);
+
+
+// Timing counters of LoopScheduler
+struct LoopStats
+{
+	uint64_t num_period = 0;		// periods elapsed since Start()
+	uint64_t num_cycle = 0;			// cycles run (num_period - missed periods)
+	uint64_t num_overrun = 0;		// cycles longer than the period (1 or more periods missed)
+	uint64_t num_missed = 0;		// periods skipped by overruns
+	uint64_t num_late = 0;			// wake-ups later than the tolerance
+	uint64_t num_slack = 0;			// slack work calls
+	double max_late = 0;			// latest wake-up (in seconds)
+	double mean_late = 0;
+	double max_cycle = 0;			// longest cycle work (in seconds)
+	double mean_cycle = 0;
+};
+
+
+/**
+* Fixed-rate loop : runs the sensing / control cycle at a known sample period instead of a free-running loop
+*
+*	loop_scheduler.Start(50.0);
+*	while(true)
+*	{
+*		loop_scheduler.Wait();	// sleeps until the next period
+*		...cycle...
+*	}
+*
+* Periods are absolute deadlines (timerfd on Linux, sleep_until elsewhere), so the rate does not drift.
+* A cycle longer than the period is an overrun : the missed periods are skipped (not run in a burst) & counted.
+* Optional slack work runs after the cycle, while there is still time before the next deadline.
+*/
+class LoopScheduler
+{
+public:
+	LoopScheduler();
+	~LoopScheduler();
+
+	bool Start(double rate_hz, double late_tolerance = 0.1);
+
+	void Stop();
+
+	void setSlackWork(SlackFunction function, void* context, double margin = 0.2);
+
+	int Wait();
+
+	double getPeriod() { return period; }
+
+	void getStats(LoopStats* stats);
+
+private:
+	double period = 0;				// in seconds
+	double late_tolerance = 0;		// in seconds
+	bool running = false;
+
+	SlackFunction slack_function = 0;
+	void* slack_context = 0;
+	double slack_margin = 0;		// fraction of the period kept free before the next deadline
+
+	int timer_fd = -1;
+	uint64_t expired = 0;			// timer expirations read from timer_fd
+	std::chrono::time_point<std::chrono::steady_clock> time_point_start;
+	std::chrono::time_point<std::chrono::steady_clock> time_point_cycle;	// wake-up of the current cycle
+	uint64_t next_period = 0;		// index of the next deadline since time_point_start
+
+	LoopStats stats;
+	double total_late = 0;
+	double total_cycle = 0;
+
+	std::chrono::time_point<std::chrono::steady_clock> getDeadline(uint64_t index);
+
+	void RunSlack();
+};
+
+
+#endif // LOOP_SCHEDULER_HPP
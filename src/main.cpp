@@ -1,20 +1,294 @@
 // Example code how to read the serial port and process the pressure data from the foot sensor
 
 
+#include <csignal>
 #include <iostream>
 #include <string.h>
+#include <algorithm>
 #include <chrono>
 // Command Parser
 #include <unistd.h>
 #include <getopt.h>
 
 #include "foot_sensor.hpp"
+#include "gait_metrics.hpp"
+#include "pipeline.hpp"
+#include "static_chain.hpp"
+#include "realtime_thread.hpp"
+#include "loop_scheduler.hpp"
+#include "session_manager.hpp"
+#include "gait_event_bus.hpp"
+#include "pressure_shm.hpp"
+#include "acquisition_daemon.hpp"
+#include "frame_fanout.hpp"
+#include "alloc_tracker.hpp"
+#include "trace.hpp"
+#include "realtimefile_io.hpp"
 
 
 bool use_foot_sensor = true;    // Flag from the command parser
+bool use_predictive_heel_strike = false;    // true -> heel-strike fires on the 1st frame of heel loading
+bool use_pipeline = false;      // true -> foot-sensor processing runs on its own threads, see Pipeline
+bool use_static_chain = false;  // true -> only the inlined decode -> COP -> spike filter -> heel strike chain runs (lowest latency)
+bool use_realtime = false;      // true -> the thread reading the foot-sensors runs SCHED_FIFO, pinned, with locked memory
+double loop_rate = 20.0;        // rate of the sensing / control loop (in Hz) : reading both foot-sensors (2x210 bytes at 115200 baud) blocks ~36.5 ms
+bool use_shared_memory = false; // true -> every frame is published in shared memory "/foot_sensor" for other processes (see PressureShmReader)
+bool use_session_manager = false;   // true -> serve several subjects (insole pairs) instead of the exoskeleton loop
+bool use_frame_fanout = false;  // true -> frames are handed to sink threads (shared memory...) instead of being published inline
+bool use_pressure_log = false;  // true -> every frame of both foot-sensors is logged to ../data/*_pressure.bin (asynchronous writer)
+bool use_daemon = false;        // true -> only acquire & process, stream the frames to local clients (see AcquisitionDaemon)
+const char* daemon_socket = "/tmp/foot_sensor.sock";
+const char* replay_file = NULL; // --replay FILE : evaluate the heel-strike detection on a recorded pressure log, then exit
+
+// Serial ports of each subject (left, right), for the session manager
+const char* subject_comport[][2] = { { "0", "1" }, { "2", "3" }, { "4", "5" }, { "6", "7" } };
+const int num_subject = sizeof(subject_comport) / sizeof(subject_comport[0]);
+
+
+// Set by SIGINT / SIGTERM in the session-manager mode, so its threads are stopped before exiting
+volatile std::sig_atomic_t signal_stop = 0;
+
+void OnSignal(int)
+{
+    signal_stop = 1;
+}
+
+
+// Heel strike delivered by the gait event bus, as soon as it is detected
+// (called on the thread that detects the events : the main loop, or the pipeline)
+void OnHeelStrike(void* context, const GaitEventMessage& message)
+{
+    if (!use_predictive_heel_strike)
+        static_cast<std::atomic<int>*>(context)->store(message.record.foot);
+}
+
+
+// Live status printed in the slack of the loop period, so printing never delays the next sensor reading
+struct PrintContext
+{
+    PressureData* pressure_data;
+    GaitSummary* gait_summary;
+};
+
+bool PrintStatus(void* context)
+{
+    PrintContext* ctx = static_cast<PrintContext*>(context);
+    std::cout << "[SWING PHASE]\tRight Pressure Sum = " << ctx->pressure_data->right_pressure
+            << "\tCadence = " << ctx->gait_summary->cadence
+            << "\tStance L/R = " << ctx->gait_summary->stance_percent[0] << "/" << ctx->gait_summary->stance_percent[1]
+            << "\tAsymmetry = " << ctx->gait_summary->stance_asymmetry << "\r";
+    return false;   // once per period
+}
+
+
+// Objects shared by the foot-sensor pipeline stages
+struct PipelineContext
+{
+    FootSensor* foot_sensor;
+    USBStream* serial_port;
+    RealTimeFileIO* pressure_log;   // frame log written by the events stage, NULL if not logged here
+    std::atomic<int> heel_strike;   // last heel strike, taken by the control loop
+};
+
+// Group 0 : acquisition only, paces the pipeline
+void StageAcquire(void* context, PipelineFrame* frame)
+{
+    PipelineContext* ctx = static_cast<PipelineContext*>(context);
+    ctx->foot_sensor->ReadPressurePacket(ctx->serial_port, &frame->packet);
+}
+
+// Group 1 : latency-critical calculations
+void StageDecode(void* context, PipelineFrame* frame)
+{
+    static_cast<PipelineContext*>(context)->foot_sensor->DecodePressureData(&frame->packet, &frame->data);
+}
+
+void StageFilter(void* context, PipelineFrame* frame)
+{
+    static_cast<PipelineContext*>(context)->foot_sensor->CalcFilteredCOP(&frame->data);
+}
+
+void StageFeatures(void* context, PipelineFrame* frame)
+{
+    FootSensor* foot_sensor = static_cast<PipelineContext*>(context)->foot_sensor;
+    foot_sensor->CalcCOP(&frame->data);
+    foot_sensor->CalcContact(&frame->data);
+    foot_sensor->CalcCOPKalman(&frame->data);
+}
+
+void StageEvents(void* context, PipelineFrame* frame)
+{
+    PipelineContext* ctx = static_cast<PipelineContext*>(context);
+    GaitEventRecord gait_events[2];
+    ctx->foot_sensor->getGaitEvents(&frame->data, gait_events);     // heel strike is delivered by the event bus
+
+    int heel_strike_predictive = ctx->foot_sensor->getHeelStrike_Predictive(&frame->data);
+    if (use_predictive_heel_strike && heel_strike_predictive > 0)
+        ctx->heel_strike = heel_strike_predictive;
+
+    ctx->foot_sensor->StoreHistory(&frame->data);
+    if (ctx->pressure_log)
+        ctx->pressure_log->savePressure(ctx->foot_sensor->getHistory()->newest());
+}
+
+// Group 2 : console output, dropped rather than slowing down the calculations
+void StagePrint(void* context, PipelineFrame* frame)
+{
+    std::cout << "[SWING PHASE]\tRight Pressure Sum = " << frame->data.right_pressure
+            << "\tGait Phase L/R = " << frame->data.left_gait_phase << "/" << frame->data.right_gait_phase << "\r";
+}
+
+// Sink of the frame fan-out : publication to the other processes, off the acquisition thread
+void SinkSharedMemory(void* context, const PressureFrame* frame)
+{
+    static_cast<PressureShmWriter*>(context)->Publish(*frame);
+}
+
+// Sink of the frame fan-out : pressure-frame log
+void SinkPressureLog(void* context, const PressureFrame* frame)
+{
+    static_cast<RealTimeFileIO*>(context)->savePressure(*frame);
+}
+
+// Replay a pressure log (see RealTimeFileIO::initPressure()) : heel-strike latency of each foot & decisions of the static chain
+// Returns 1 if the log cannot be read, or if the chain misses every heel-strike of the session
+int ReplaySession(const char* filename)
+{
+    std::vector<PressureFrame> frames;
+    MatrixIO matrix_io;
+    if (matrix_io.readPressureFrames(filename, &frames) < 0)
+    {
+        std::cerr << "Cannot read pressure log " << filename << std::endl;
+        return 1;
+    }
+    std::cout << filename << " : " << frames.size() << " frames" << std::endl;
+
+    FootSensor foot_sensor;
+    foot_sensor.InitHeelStrike_Predictive(HeelStrikePredictorConfig());
+
+    const char* foot_name[2] = { "Left", "Right" };
+    int num_truth = 0;
+    for (int foot = 1; foot <= 2; foot++)
+    {
+        HeelStrikeLatencyReport report;
+        foot_sensor.EvaluateHeelStrikeLatency(frames, foot, &report);
+        num_truth += report.num_truth;
+        std::cout << foot_name[foot - 1] << " heel-strikes : " << report.num_detected << "/" << report.num_truth << " detected\t"
+                << report.num_missed << " missed\t" << report.num_false << " false\tlatency mean " << report.mean_latency * 1e3
+                << " ms\tp95 " << report.p95_latency * 1e3 << " ms\tmax " << report.max_latency * 1e3 << " ms" << std::endl;
+    }
+
+    // Same frames through the static chain (minus the serial read) : it must reach heel-strike decisions too
+    PressureData pressure_data;
+    pressure_data.sensor_left.setZero(pressure_data.n_row, pressure_data.n_col);
+    pressure_data.sensor_right.setZero(pressure_data.n_row, pressure_data.n_col);
+    ChainContext chain_context;
+    chain_context.foot_sensor = &foot_sensor;
+    chain_context.serial_port = NULL;
+    chain_context.pressure_data = &pressure_data;
+    ChainLatency chain_latency(1e-3);
+
+    int chain_heel_strike[2] = { 0, 0 };
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        chain_context.frame = &frames[i];
+        int heel_strike = chain_latency.Run<HeelStrikeReplayChain>(&chain_context);
+        if (heel_strike > 0)
+            chain_heel_strike[heel_strike - 1]++;
+    }
+    std::cout << "Heel-strike chain : " << chain_heel_strike[0] << " left\t" << chain_heel_strike[1] << " right\tlatency mean "
+            << chain_latency.getMean() * 1e3 << " ms\tmax " << chain_latency.getMax() * 1e3 << " ms" << std::endl;
+
+    if (num_truth > 0 && chain_heel_strike[0] + chain_heel_strike[1] == 0)
+    {
+        std::cerr << "Heel-strike chain never fired" << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char** argv)
 {
+    // --daemon [--socket PATH] : run as the acquisition daemon ; --replay FILE : evaluate a recorded session
+    const option long_options[] = {
+        { "daemon", no_argument, NULL, 'd' },
+        { "socket", required_argument, NULL, 's' },
+        { "replay", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ds:r:", long_options, NULL)) != -1)
+    {
+        if (opt == 'd')
+            use_daemon = true;
+        else if (opt == 's')
+            daemon_socket = optarg;
+        else if (opt == 'r')
+            replay_file = optarg;
+    }
+
+    // Offline evaluation : no foot-sensor needed
+    if (replay_file)
+        return ReplaySession(replay_file);
+
+    // Acquisition daemon : owns the foot-sensors, recording / visualisation / control connect to its socket
+    if (use_daemon)
+    {
+        FootSensor foot_sensor;
+        PressureData pressure_data;
+        USBStream serial_port[2];
+        foot_sensor.OpenSerialPort(serial_port);
+        foot_sensor.FilterSpike_Init(serial_port, &pressure_data);
+        foot_sensor.InitPressureFilter(8.0, loop_rate, 2);
+        foot_sensor.InitCOPKalman(1000.0, 0.05, 5);
+        foot_sensor.InitGaitEvents(GaitEventConfig());
+
+        // The daemon processes the frames in pressure_data, initialized above
+        AcquisitionDaemon daemon;
+        if (!daemon.Open(daemon_socket, &foot_sensor, serial_port, &pressure_data))
+            return 1;
+        std::cout << "Acquisition daemon on " << daemon_socket << std::endl;
+        daemon.Run();
+        return 0;
+    }
+
+    // Multi-subject session : every subject is read by its own thread & processed on the worker pool, report once per second
+    if (use_session_manager)
+    {
+        SessionManager session_manager;
+        for (int i = 0; i < num_subject; i++)
+            session_manager.AddSubject("subject_" + std::to_string(i + 1), subject_comport[i][0], subject_comport[i][1]);
+
+        if (!session_manager.Start())
+            return 1;
+        std::cout << num_subject << " subjects on " << session_manager.getNumWorker() << " workers" << std::endl;
+
+        // Ctrl+C / kill : leave the loop, then stop & join the readers and the workers
+        std::signal(SIGINT, OnSignal);
+        std::signal(SIGTERM, OnSignal);
+        while (!signal_stop)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            for (int i = 0; i < session_manager.getNumSubject(); i++)
+            {
+                SubjectStats stats;
+                GaitSummary summary;
+                session_manager.getStats(i, &stats);
+                session_manager.getSummary(i, &summary);
+                if (stats.active)
+                    std::cout << session_manager.getName(i) << "\t" << stats.throughput << " Hz\tread " << stats.mean_read * 1e3
+                            << " ms\tlatency " << stats.mean_latency * 1e3 << "/" << stats.max_latency * 1e3 << " ms"
+                            << "\tdropped " << stats.dropped << "\ttime-outs " << stats.timeouts << "\tcadence " << summary.cadence << std::endl;
+            }
+        }
+
+        session_manager.Stop();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        std::cout << "Session stopped" << std::endl;
+        return 0;
+    }
+
     // To calculate pressure data
     FootSensor foot_sensor;
 
@@ -32,6 +306,12 @@ int main(int argc, char** argv)
 
         // Initialize FileterSpike in pressure reading
         foot_sensor.FilterSpike_Init(serial_port, &pressure_data);
+
+        // Initialize the low-pass filter of all pixels (cut-off, loop rate, Butterworth order)
+        foot_sensor.InitPressureFilter(8.0, loop_rate, 2);
+
+        // Initialize the Kalman filter of the COP (jerk noise, COP noise, smoother lag in frames)
+        foot_sensor.InitCOPKalman(1000.0, 0.05, 5);
     }
     
     bool spike_check[2] = {true, true};
@@ -40,9 +320,119 @@ int main(int argc, char** argv)
     int heel_strike = 0;    // 0 -> nothing ; 1 -> left-heel-strike ; 2 -> right
     int heel_check[2] = {0, 0}; // Denote 2 consecutive times checking pressure-gradiant surge
 
+    // Initialize gait event detection (heel-strike, foot-flat, heel-off, toe-off of each foot)
+    GaitEventConfig gait_config;
+    foot_sensor.InitGaitEvents(gait_config);
+
+    // Gait events are published on the bus : heel strike is delivered right away
+    GaitEventBus event_bus;
+    std::atomic<int> bus_heel_strike(0);
+    foot_sensor.setEventBus(&event_bus);
+    int heel_strike_subscriber = event_bus.SubscribeCallback(OnHeelStrike, &bus_heel_strike, GaitEventBus::EventBit(kHeelStrike));
+
+    // Initialize single-frame heel-strike detection
+    HeelStrikePredictorConfig predictor_config;
+    foot_sensor.InitHeelStrike_Predictive(predictor_config);
+
+    // Publish every frame (and the last 256) to the other processes, e.g. the exoskeleton controller
+    PressureShmWriter shared_memory;
+    if (use_shared_memory && shared_memory.Open("/foot_sensor", 256) && !use_frame_fanout)
+        foot_sensor.setSharedMemory(&shared_memory);
+
+    // Log every frame of both foot-sensors, written by a background thread
+    RealTimeFileIO pressure_log("_foot_sensor");
+    if (use_pressure_log)
+    {
+        pressure_log.setAsync(true, kWriteDrop);
+        pressure_log.initPressure();
+    }
+
+    // Or hand every frame to sink threads, without copying it per sink (loggers, displays... are added the same way)
+    FrameFanout frame_fanout;
+    if (use_frame_fanout)
+    {
+        if (shared_memory.isOpen())
+            frame_fanout.AddSink("shared_memory", SinkSharedMemory, &shared_memory);
+        if (use_pressure_log)
+            frame_fanout.AddSink("pressure_log", SinkPressureLog, &pressure_log);
+        if (frame_fanout.Start())
+            foot_sensor.setFrameFanout(&frame_fanout);
+    }
+
+    // Per-frame calculations : subscribe to what this program reads, dependencies are added by the graph
+    MetricGraph metric_graph;
+    foot_sensor.RegisterMetrics(&metric_graph, serial_port);
+    if(use_foot_sensor)
+    {
+        metric_graph.Subscribe("cop_kalman");       // COP filtered, with velocity & acceleration
+        metric_graph.Subscribe("contact");          // contact area & number of separate contacts
+        metric_graph.Subscribe("filtered_cop");     // low-pass filtered pressure-sum & COP
+        metric_graph.Subscribe("gait_events");      // heel-strike, foot-flat, heel-off, toe-off
+        metric_graph.Subscribe("heel_strike");      // single-frame heel-strike
+        metric_graph.Subscribe("pressure_maps");    // peak pressure & pressure-time-integral maps
+        metric_graph.Subscribe("history");          // history ring for windowed algorithms
+    }
+
+    // Or run the foot-sensor processing on 3 threads : acquire | decode -> filter -> features -> events | print
+    Pipeline pipeline;
+    PipelineContext pipeline_context;
+    pipeline_context.foot_sensor = &foot_sensor;
+    pipeline_context.serial_port = serial_port;
+    pipeline_context.pressure_log = (use_pressure_log && !use_frame_fanout) ? &pressure_log : NULL;
+    pipeline_context.heel_strike = 0;
+    if(use_foot_sensor && use_pipeline)
+    {
+        pipeline.AddStage("acquire", StageAcquire, &pipeline_context, 0);
+        pipeline.AddStage("decode", StageDecode, &pipeline_context, 1);
+        pipeline.AddStage("filter", StageFilter, &pipeline_context, 1);
+        pipeline.AddStage("features", StageFeatures, &pipeline_context, 1);
+        pipeline.AddStage("events", StageEvents, &pipeline_context, 1);
+        pipeline.AddStage("print", StagePrint, &pipeline_context, 2, kQueueDropNewest);
+        if (use_realtime)
+        {
+            RealTimeConfig realtime_config;
+            realtime_config.cpu = 1;
+            pipeline.setGroupRealTime(0, realtime_config);
+            realtime_config.cpu = 2;
+            realtime_config.priority = 79;
+            pipeline.setGroupRealTime(1, realtime_config);
+        }
+        pipeline.Start(pressure_data);
+    }
+
+    // Or run only the fixed, compile-time composed heel-strike chain
+    ChainContext chain_context;
+    chain_context.foot_sensor = &foot_sensor;
+    chain_context.serial_port = serial_port;
+    chain_context.pressure_data = &pressure_data;
+    ChainLatency chain_latency(1e-3);   // sensor-to-decision budget of 1 ms
+
+    // Initialize online gait metrics (rolling window of the last 10 strides per foot)
+    GaitMetrics gait_metrics;
+    gait_metrics.Init(10);
+    GaitSummary gait_summary;
+
+    // Real-time mode of this thread (reads the foot-sensors, unless the pipeline does), with a jitter self-test
+    if (use_realtime && !use_pipeline)
+    {
+        RealTimeConfig realtime_config;
+        realtime_config.cpu = 1;
+        RealTimeStatus realtime_status;
+        RealTimeThread::Apply(realtime_config, &realtime_status);
+        RealTimeThread::Print(realtime_status);
+    }
+
     /*===================== INITIALIZE WHILE LOOP =====================*/
+    Trace::setThreadName("main loop");     // timeline of the trace points (-DTRACE=ON)
     auto program_start = std::chrono::steady_clock::now();
     int num_loop = 0;
+
+    // Fixed sample period of the loop, printing in the slack of each period
+    LoopScheduler loop_scheduler;
+    PrintContext print_context = { &pressure_data, &gait_summary };
+    if (!use_pipeline)
+        loop_scheduler.setSlackWork(PrintStatus, &print_context);
+    loop_scheduler.Start(loop_rate);
     // Flag of step_complete
     bool step_complete = false;
     bool right_leading;
@@ -52,19 +442,65 @@ int main(int argc, char** argv)
 
     while(true)
     {
-        if(use_foot_sensor)
+        // Sleep until the next period
+        loop_scheduler.Wait();
+        num_loop++;
+
+        if(use_foot_sensor && use_pipeline)
+        {
+            // Heel strike detected by the pipeline since the last loop (event bus or predictive)
+            int heel_strike_pipeline = std::max(bus_heel_strike.exchange(0), pipeline_context.heel_strike.exchange(0));
+            if (heel_strike_pipeline > 0)
+                heel_strike = heel_strike_pipeline;
+        }
+        else if(use_foot_sensor && use_static_chain)
+        {
+            // Read the foot-sensors & decide heel strike in one inlined call
+            int heel_strike_chain = chain_latency.Run<HeelStrikeChain>(&chain_context);
+            if (heel_strike_chain > 0)
+                heel_strike = heel_strike_chain;
+
+            // The chain keeps no history : store the frame after the decision, for the log, shared memory & sinks
+            if (use_pressure_log || shared_memory.isOpen() || use_frame_fanout)
+                foot_sensor.StoreHistory(&pressure_data);
+            if (use_pressure_log && !use_frame_fanout)
+                pressure_log.savePressure(foot_sensor.getHistory()->newest());
+        }
+        else if(use_foot_sensor)
         {
-            // Read foot-sensor 99 pixels & store into PressureData struct
-            foot_sensor.ReadPressureData(serial_port, &pressure_data);
-            std::cout << "[SWING PHASE]\tRight Pressure Sum = " << pressure_data.right_pressure;
+            // Test mode (-DALLOC_TRACKER=ON) : no allocation allowed in the per-frame calculations after the warm-up
+            if (num_loop > 10)
+                AllocTracker::Arm();
 
-            // Calculate the COP of 2 foot-sensors
-            foot_sensor.CalcCOP(&pressure_data);
+            // Read the foot-sensors & calculate the subscribed metrics (and only those)
+            metric_graph.Evaluate(&pressure_data);
+
+            // Log the frame (the sink thread does it with the frame fan-out)
+            if (use_pressure_log && !use_frame_fanout)
+                pressure_log.savePressure(foot_sensor.getHistory()->newest());
+
+            // Heel strike delivered by the event bus during the calculation
+            int heel_strike_bus = bus_heel_strike.exchange(0);
+            if (heel_strike_bus > 0)
+                heel_strike = heel_strike_bus;
 
             // Check heel strike
             foot_sensor.getHeelStrike(&pressure_data, &heel_check[0]);
+
+            // Gait events of both feet detected in this frame (heel strike is delivered by the event bus)
+            const GaitEventRecord* gait_events;
+            int num_event = foot_sensor.getFrameEvents(&gait_events);
+
+            // Update stride timing & the live gait quality
+            if (gait_metrics.Update(gait_events, num_event) > 0)
+                gait_metrics.getSummary(&gait_summary);
+
+            // Heel strike on the 1st frame of heel loading
+            if (use_predictive_heel_strike && pressure_data.heel_strike > 0)
+                heel_strike = pressure_data.heel_strike;
+
+            AllocTracker::Disarm();
         }
-        std::cout << "\r";
 
         // Get another key-stroke for either step_complete or forced_stop
         char kb_press = kb.getNonBlockingTriggers();
@@ -82,5 +518,65 @@ int main(int argc, char** argv)
 
     save_file.end();
 
+    // Timing of the loop
+    LoopStats loop_stats;
+    loop_scheduler.getStats(&loop_stats);
+    std::cout << "Loop " << num_loop << " cycles at " << loop_rate << " Hz : overruns " << loop_stats.num_overrun
+            << " (" << loop_stats.num_missed << " periods missed)\tlate wake-ups " << loop_stats.num_late
+            << "\tmax late " << loop_stats.max_late * 1e3 << " ms\tmax cycle " << loop_stats.max_cycle * 1e3 << " ms" << std::endl;
+
+    // Delivery latency of the heel strikes
+    GaitEventLatency event_latency;
+    event_bus.getLatency(heel_strike_subscriber, &event_latency);
+    std::cout << "Heel strikes delivered " << event_latency.delivered << " : mean " << event_latency.mean * 1e6
+            << " us\tmax " << event_latency.max * 1e6 << " us" << std::endl;
+
+    // Sensor-to-decision latency of the static chain
+    if (chain_latency.getCount() > 0)
+        std::cout << "Heel-strike chain latency : mean " << chain_latency.getMean() * 1e3 << " ms\tmax " << chain_latency.getMax() * 1e3
+                << " ms\tover budget " << chain_latency.getOverBudget() << "/" << chain_latency.getCount() << std::endl;
+
+    // Stop the pipeline & print the load of each stage
+    if (pipeline.isRunning())
+    {
+        pipeline.Stop();
+        for (int i = 0; i < pipeline.getNumStage(); i++)
+        {
+            StageStats stats;
+            pipeline.getStats(i, &stats);
+            std::cout << stats.name << "\t" << stats.throughput << " Hz\tmean " << stats.mean_time * 1e3 << " ms\tmax "
+                    << stats.max_time * 1e3 << " ms\tdropped " << stats.dropped << std::endl;
+        }
+    }
+
+    // Stop the sinks & print how they kept up
+    if (use_frame_fanout)
+    {
+        foot_sensor.setFrameFanout(NULL);
+        frame_fanout.Stop();
+        for (int i = 0; i < frame_fanout.getNumSink(); i++)
+        {
+            SinkStats stats;
+            frame_fanout.getStats(i, &stats);
+            std::cout << stats.name << "\tdelivered " << stats.delivered << "\tmean " << stats.mean_time * 1e3 << " ms\tmax "
+                    << stats.max_time * 1e3 << " ms\tdropped " << stats.dropped << std::endl;
+        }
+        std::cout << "Frame pool exhausted " << frame_fanout.getNumExhausted() << " times" << std::endl;
+    }
+
+    // Close the pressure log & print how the disk kept up
+    if (use_pressure_log)
+    {
+        pressure_log.end();
+        AsyncWriterStats log_stats;
+        pressure_log.getAsyncStats(&log_stats);
+        std::cout << "Pressure log : " << log_stats.records << " frames\tdropped " << log_stats.dropped << "\tmax queue "
+                << log_stats.max_queue_bytes << " bytes\tmax block write " << log_stats.max_write_time * 1e3 << " ms" << std::endl;
+    }
+
+    // Timeline of the last frames of every thread, open in https://ui.perfetto.dev
+    if (Trace::Dump("foot_sensor_trace.json"))
+        std::cout << "Trace written to foot_sensor_trace.json" << std::endl;
+
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <string>
 #include <istream>
 #include <stdexcept>
+#include <cstring>
 
 #include "matrix_io.hpp"
 #include "variable_conversion.hpp"
@@ -788,6 +789,95 @@ Eigen::MatrixXf MatrixIO::readFromFileBinary(const std::string filename)
 	return readFromFileBinary(&filename, 1, &rows);
 }
 
+/** @brief read the frames of a pressure-frame file, as written by RealTimeFileIO::savePressure()
+ *
+ * The file must be stored with the following format: \n
+ * a PressureFileHeader, then one PressureFrame per frame (see RealTimeFileIO::initPressure()) \n
+ * An incomplete last frame (e.g. the program crashed while writing it) is ignored.
+ *
+ * @param[in] filename the file location with the stored frames
+ * @param[out] frames all frames of the file, in the order they were saved
+ *
+ * @return returns the number of frames, -1 if the file cannot be read or is not a pressure-frame file of this version
+ */
+int MatrixIO::readPressureFrames(const std::string filename, std::vector<PressureFrame>* frames)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		std::cerr << "Cannot open " << filename << std::endl;
+		return -1;
+	}
+
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	PressureFileHeader header;
+	if (size < (std::streamoff)sizeof(header) || !file.read((char*)&header, sizeof(header))
+		|| memcmp(header.magic, PressureFileMagic, sizeof(header.magic)) != 0
+		|| header.version != PressureFileVersion || header.record_size != sizeof(PressureFrame))
+	{
+		std::cerr << filename << " is not a pressure-frame file of this version" << std::endl;
+		return -1;
+	}
+
+	int num_frame = (int)((size - sizeof(header)) / sizeof(PressureFrame));
+	frames->resize(num_frame);
+	if (num_frame > 0)
+		file.read((char*)frames->data(), (std::streamsize)num_frame * sizeof(PressureFrame));
+
+	return num_frame;
+}
+
+/** @brief read a pressure-frame file as a matrix, one row per frame
+ *
+ * The matrix will follow the following format (foot order : left, right):
+ * Col 1 = time_stamp
+ * Col 2 = seq
+ * Col 3 = event_flags
+ * Col 4-5 = gait_phase
+ * Col 6-7 = contact_area
+ * Col 8-9 = pressure
+ * Col 10-11 = cop_x
+ * Col 12-13 = cop_y
+ * Col 14-15 = pressure_grad
+ * Col 16-120 = left cells (column-major)
+ * Col 121-225 = right cells (column-major)
+ *
+ * @param[in] filename the file location with the stored frames
+ *
+ * @return returns matrix (empty if the file cannot be read)
+ */
+Eigen::MatrixXf MatrixIO::readFromPressureFile(const std::string filename)
+{
+	const int n_cell = 105;
+	std::vector<PressureFrame> frames;
+	int num_frame = readPressureFrames(filename, &frames);
+	if (num_frame <= 0)
+		return Eigen::MatrixXf();
+
+	Eigen::MatrixXf matrix(num_frame, 15 + 2 * n_cell);
+	for (int i = 0; i < num_frame; i++)
+	{
+		const PressureFrame& f = frames[i];
+		matrix(i, 0) = (float)f.time_stamp;
+		matrix(i, 1) = (float)f.seq;
+		matrix(i, 2) = f.event_flags;
+		for (int foot = 0; foot < 2; foot++)
+		{
+			matrix(i, 3 + foot) = f.gait_phase[foot];
+			matrix(i, 5 + foot) = f.contact_area[foot];
+			matrix(i, 7 + foot) = f.pressure[foot];
+			matrix(i, 9 + foot) = f.cop_x[foot];
+			matrix(i, 11 + foot) = f.cop_y[foot];
+			matrix(i, 13 + foot) = f.pressure_grad[foot];
+			for (int k = 0; k < n_cell; k++)
+				matrix(i, 15 + foot * n_cell + k) = f.cells[foot][k];
+		}
+	}
+	return matrix;
+}
+
 /** @brief write the matrix data to a binary file
  *
  * The binary file must be stored with the following format: \n
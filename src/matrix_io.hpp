@@ -5,7 +5,9 @@
 #include <Eigen/Core>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include "main.hpp"
+#include "pressure_frame.hpp"
 
 
 /**
@@ -37,6 +39,8 @@ public:
 	Eigen::MatrixXf readFromIMUBinaryOrdered(const std::string filename, int& num_imu, int** imu_order);
 	Eigen::MatrixXf readFromFileBinary(const std::string* filename, int numfiles, int* filerows);
 	Eigen::MatrixXf readFromFileBinary(const std::string filename);
+	int readPressureFrames(const std::string filename, std::vector<PressureFrame>* frames);
+	Eigen::MatrixXf readFromPressureFile(const std::string filename);
 	void writeToFile(const std::string filename, const Eigen::MatrixXf& matrix);
 	void writeToFileBinary(std::string outputfile, const Eigen::MatrixXf& mat, bool concat = false);
 	void writeToFileNumbered(const std::string filename, const Eigen::MatrixXf& matrix);
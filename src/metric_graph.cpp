@@ -0,0 +1,140 @@
+#include <cstring>
+#include <iostream>
+
+#include "metric_graph.hpp"
+
+
+/*
+@brief	Add a metric to the registry
+
+@param[in]	name		unique name of the metric (the string must outlive the graph, e.g. a literal)
+@param[in]	function	calculation of the metric
+@param[in]	context		object passed to function (e.g. FootSensor)
+@param[in]	depends		names of the metrics it depends on, already registered
+@param[in]	num_depend	number of names in depends[]
+
+@return	id of the metric, -1 if the registry is full, the name exists or a dependency is unknown
+*/
+int MetricGraph::Register(const char* name, MetricFunction function, void* context, const char* const* depends, int num_depend)
+{
+	if (num_metric >= max_metric || Find(name) >= 0)
+	{
+		std::cerr << "MetricGraph: cannot register " << name << std::endl;
+		return -1;
+	}
+
+	uint64_t depend_mask = 0;
+	for (int i = 0; i < num_depend; i++)
+	{
+		int id = Find(depends[i]);
+		if (id < 0)
+		{
+			std::cerr << "MetricGraph: " << name << " depends on unknown metric " << depends[i] << std::endl;
+			return -1;
+		}
+		depend_mask |= uint64_t(1) << id;
+	}
+
+	Metric& m = metric[num_metric];
+	m.name = name;
+	m.function = function;
+	m.context = context;
+	m.depends = depend_mask;
+	m.subscribers = 0;
+	return num_metric++;
+}
+
+
+/*
+@brief	Find a metric by name
+
+@return	id of the metric, -1 if not registered
+*/
+int MetricGraph::Find(const char* name)
+{
+	for (int i = 0; i < num_metric; i++)
+	{
+		if (strcmp(metric[i].name, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+
+/*
+@brief	Request a metric (and, implicitly, all its dependencies) on every frame
+Subscriptions are counted, so several consumers can subscribe to the same metric.
+
+@return	false if the metric is not registered
+*/
+bool MetricGraph::Subscribe(const char* name)
+{
+	int id = Find(name);
+	if (id < 0)
+		return false;
+
+	metric[id].subscribers++;
+	Resolve();
+	return true;
+}
+
+
+/*
+@brief	Release one subscription of a metric
+
+@return	false if the metric is not registered or not subscribed
+*/
+bool MetricGraph::Unsubscribe(const char* name)
+{
+	int id = Find(name);
+	if (id < 0 || metric[id].subscribers == 0)
+		return false;
+
+	metric[id].subscribers--;
+	Resolve();
+	return true;
+}
+
+
+/*
+@brief	Rebuild the schedule : subscribed metrics & the closure of their dependencies, in registration order
+This is an internal function, only called when subscriptions change.
+*/
+void MetricGraph::Resolve()
+{
+	uint64_t needed = 0;
+	for (int i = 0; i < num_metric; i++)
+	{
+		if (metric[i].subscribers > 0)
+			needed |= uint64_t(1) << i;
+	}
+
+	// Dependencies always have a smaller id, so one backward sweep closes the set
+	for (int i = num_metric - 1; i >= 0; i--)
+	{
+		if (needed & (uint64_t(1) << i))
+			needed |= metric[i].depends;
+	}
+
+	num_schedule = 0;
+	for (int i = 0; i < num_metric; i++)
+	{
+		if (needed & (uint64_t(1) << i))
+			schedule[num_schedule++] = i;
+	}
+}
+
+
+/*
+@brief	Calculate the scheduled metrics of one frame, in topological order
+
+@param[in/out]	pressure_data	struct that holds the inputs and receives the results of all metrics
+*/
+void MetricGraph::Evaluate(PressureData* pressure_data)
+{
+	for (int i = 0; i < num_schedule; i++)
+	{
+		const Metric& m = metric[schedule[i]];
+		m.function(m.context, pressure_data);
+	}
+}
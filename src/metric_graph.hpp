@@ -0,0 +1,65 @@
+#ifndef METRIC_GRAPH_HPP
+#define METRIC_GRAPH_HPP
+
+#include <stdint.h>
+
+struct PressureData;
+
+
+// A metric calculation : reads its dependencies from pressure_data and writes its own result into it
+typedef void (*MetricFunction)(void* context, PressureData* pressure_data);
+
+
+/**
+* Demand-driven registry of per-frame metrics
+*
+* Each metric declares the metrics it depends on, which must be registered BEFORE it,
+* so the registration order is always a valid topological order.
+* Consumers subscribe to the metrics they read ; on every (un)subscription
+* the schedule is rebuilt as the subscribed metrics plus all their dependencies, in registration order.
+* Evaluate() then only runs that schedule : no lookup, no allocation.
+*
+* Unsubscribed analytics therefore cost nothing per frame.
+*/
+class MetricGraph
+{
+public:
+	static const int max_metric = 64;
+
+	int Register(const char* name, MetricFunction function, void* context, const char* const* depends = 0, int num_depend = 0);
+
+	int Find(const char* name);
+
+	bool Subscribe(const char* name);
+
+	bool Unsubscribe(const char* name);
+
+	void Evaluate(PressureData* pressure_data);
+
+	int getNumMetric() { return num_metric; }
+
+	int getScheduleSize() { return num_schedule; }
+
+	const char* getScheduledName(int i) { return metric[schedule[i]].name; }
+
+private:
+	struct Metric
+	{
+		const char* name;
+		MetricFunction function;
+		void* context;
+		uint64_t depends;		// bit i -> depends on metric i
+		int subscribers;
+	};
+
+	Metric metric[max_metric];
+	int num_metric = 0;
+
+	int schedule[max_metric];	// metric ids to run, in topological order
+	int num_schedule = 0;
+
+	void Resolve();
+};
+
+
+#endif // METRIC_GRAPH_HPP
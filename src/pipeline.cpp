@@ -0,0 +1,296 @@
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#endif
+
+#include "pipeline.hpp"
+#include "trace.hpp"
+
+
+Pipeline::Pipeline() : running(false)
+{
+	for (int g = 0; g < max_group; g++)
+	{
+		group_cpu[g] = -1;
+		group_realtime[g] = false;
+	}
+}
+
+
+Pipeline::~Pipeline()
+{
+	Stop();
+}
+
+
+/*
+@brief	Append a stage, before Start()
+
+@param[in]	name		name of the stage, for the statistics (e.g. a literal)
+@param[in]	function	calculation of the stage
+@param[in]	context		object passed to function (e.g. FootSensor)
+@param[in]	group		thread group, same or next group as the previous stage (1st stage -> group 0)
+@param[in]	policy		what to do when the queue in front of this stage is full (1st stage of a group only)
+
+@return	index of the stage, -1 if rejected
+*/
+int Pipeline::AddStage(const char* name, PipelineFunction function, void* context, int group, QueuePolicy policy)
+{
+	int prev_group = (num_stage > 0) ? stage[num_stage - 1].group : -1;
+	if (running.load() || num_stage >= max_stage || group >= max_group || group < prev_group || group > prev_group + 1)
+	{
+		std::cerr << "Pipeline: cannot add stage " << name << " to group " << group << std::endl;
+		return -1;
+	}
+
+	Stage& s = stage[num_stage];
+	s.name = name;
+	s.function = function;
+	s.context = context;
+	s.group = group;
+	s.policy = policy;
+
+	if (group > prev_group)
+	{
+		group_first[group] = num_stage;
+		num_group = group + 1;
+	}
+	return num_stage++;
+}
+
+
+/*
+@brief	Pin the thread of a group to one CPU core, before Start() (Linux & Windows)
+
+@param[in]	cpu		core index, -1 -> not pinned
+*/
+void Pipeline::setGroupCPU(int group, int cpu)
+{
+	if (group >= 0 && group < max_group)
+		group_cpu[group] = cpu;
+}
+
+
+/*
+@brief	Run the thread of a group in real-time mode (see RealTimeThread), before Start()
+The settings are applied by the thread itself when it starts, before its 1st frame.
+*/
+void Pipeline::setGroupRealTime(int group, const RealTimeConfig& config)
+{
+	if (group >= 0 && group < max_group)
+	{
+		group_realtime[group] = true;
+		group_realtime_config[group] = config;
+	}
+}
+
+
+/*
+@brief	Reset the counters and start one thread per group
+
+@param[in]	initial_data	every frame of the pool starts as a copy of it (e.g. pressure_data after FilterSpike_Init())
+@return	false if already running or no stage
+*/
+bool Pipeline::Start(const PressureData& initial_data)
+{
+	if (running.load() || num_stage == 0)
+		return false;
+
+	for (int i = 0; i < num_stage; i++)
+	{
+		stage[i].processed = 0;
+		stage[i].dropped = 0;
+		stage[i].busy_ns = 0;
+		stage[i].max_ns = 0;
+	}
+
+	for (int g = 0; g < max_group; g++)
+	{
+		input_queue[g].Clear();
+		free_queue[g].Clear();
+	}
+
+	// All frames start free, the 1st group releases them to itself
+	for (int i = 0; i < num_frame; i++)
+	{
+		frame[i].data = initial_data;
+		free_queue[0].Push(i);
+	}
+
+	time_point_start = std::chrono::steady_clock::now();
+	running = true;
+
+	for (int g = 0; g < num_group; g++)
+	{
+		thread[g] = std::thread(&Pipeline::RunGroup, this, g);
+
+		if (group_cpu[g] >= 0)
+		{
+#if defined(__linux__)
+			cpu_set_t cpu_set;
+			CPU_ZERO(&cpu_set);
+			CPU_SET(group_cpu[g], &cpu_set);
+			if (pthread_setaffinity_np(thread[g].native_handle(), sizeof(cpu_set), &cpu_set) != 0)
+				std::cerr << "Pipeline: cannot pin group " << g << " to CPU " << group_cpu[g] << std::endl;
+#elif defined(_WIN32) || defined(WIN32)
+			SetThreadAffinityMask(thread[g].native_handle(), DWORD_PTR(1) << group_cpu[g]);
+#endif
+		}
+	}
+
+	return true;
+}
+
+
+/*
+@brief	Stop and join all threads. Frames still queued are discarded.
+The source stage is not interrupted : Stop() returns once its current reading is done.
+*/
+void Pipeline::Stop()
+{
+	running = false;
+	for (int g = 0; g < max_group; g++)
+	{
+		group_signal[g].Notify();
+
+		if (thread[g].joinable())
+			thread[g].join();
+	}
+}
+
+
+/*
+@brief	Get the counters of one stage (safe while running)
+*/
+void Pipeline::getStats(int index, StageStats* stats)
+{
+	const Stage& s = stage[index];
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_point_start).count();
+
+	stats->name = s.name;
+	stats->group = s.group;
+	stats->processed = s.processed.load(std::memory_order_relaxed);
+	stats->dropped = s.dropped.load(std::memory_order_relaxed);
+	stats->throughput = (elapsed > 0) ? stats->processed / elapsed : 0;
+	stats->mean_time = (stats->processed > 0) ? 1e-9 * s.busy_ns.load(std::memory_order_relaxed) / stats->processed : 0;
+	stats->max_time = 1e-9 * s.max_ns.load(std::memory_order_relaxed);
+	stats->queue_size = (s.group > 0 && group_first[s.group] == index) ? input_queue[s.group].size() : 0;
+}
+
+
+/*
+@brief	Thread of one group : get a frame, run the stages of the group, pass it on
+This is an internal function.
+*/
+void Pipeline::RunGroup(int group)
+{
+	int first = group_first[group];
+	int last = (group + 1 < num_group) ? group_first[group + 1] : num_stage;
+	Trace::setThreadName(stage[first].name);
+
+	if (group_realtime[group])
+	{
+		RealTimeStatus status;
+		RealTimeThread::Apply(group_realtime_config[group], &status);
+		RealTimeThread::Print(status);
+	}
+
+	while (running.load(std::memory_order_relaxed))
+	{
+		int index;
+		bool ready = (group == 0) ? TakeFreeFrame(&index) : input_queue[group].Pop(&index);
+		if (!ready)
+		{
+			// Sleep until the previous group forwards a frame (or a frame is released, for group 0)
+			group_signal[group].Wait([this, group]() {
+				return !running.load(std::memory_order_relaxed) || ((group == 0) ? hasFreeFrame() : !input_queue[group].isEmpty());
+			}, 0.1);
+			continue;
+		}
+
+		// Room in front of this group : the previous group may wait for it (kQueueBlock)
+		if (group > 0)
+			group_signal[group - 1].Notify();
+
+		for (int i = first; i < last; i++)
+		{
+			Stage& s = stage[i];
+			auto time_point_begin = std::chrono::steady_clock::now();
+
+			s.function(s.context, &frame[index]);
+
+			uint64_t busy = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - time_point_begin).count();
+			s.busy_ns.fetch_add(busy, std::memory_order_relaxed);
+			if (busy > s.max_ns.load(std::memory_order_relaxed))
+				s.max_ns.store(busy, std::memory_order_relaxed);
+			s.processed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Forward(group, index);
+	}
+}
+
+
+/*
+@brief	Take a frame released by any group (group 0 only)
+This is an internal function.
+*/
+bool Pipeline::TakeFreeFrame(int* index)
+{
+	for (int g = 0; g < num_group; g++)
+	{
+		if (free_queue[g].Pop(index))
+			return true;
+	}
+	return false;
+}
+
+
+/*
+@brief	Check for a frame released by any group, without taking it (group 0 only)
+This is an internal function.
+*/
+bool Pipeline::hasFreeFrame()
+{
+	for (int g = 0; g < num_group; g++)
+	{
+		if (!free_queue[g].isEmpty())
+			return true;
+	}
+	return false;
+}
+
+
+/*
+@brief	Pass a processed frame to the next group, following its queue policy, or release it after the last group
+This is an internal function.
+*/
+void Pipeline::Forward(int group, int index)
+{
+	if (group + 1 >= num_group)
+	{
+		free_queue[group].Push(index);	// never full : it holds at most num_frame frames
+		group_signal[0].Notify();
+		return;
+	}
+
+	Stage& next = stage[group_first[group + 1]];
+	while (!input_queue[group + 1].Push(index))
+	{
+		if (next.policy == kQueueDropNewest || !running.load(std::memory_order_relaxed))
+		{
+			next.dropped.fetch_add(1, std::memory_order_relaxed);
+			free_queue[group].Push(index);
+			group_signal[0].Notify();
+			return;
+		}
+
+		// Backpressure : sleep until the next group takes a frame
+		group_signal[group].Wait([this, group]() {
+			return !running.load(std::memory_order_relaxed) || input_queue[group + 1].size() < queue_size;
+		}, 0.1);
+	}
+	group_signal[group + 1].Notify();
+}
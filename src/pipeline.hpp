@@ -0,0 +1,130 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "foot_sensor.hpp"
+#include "spsc_queue.hpp"
+#include "wake_signal.hpp"
+#include "realtime_thread.hpp"
+
+
+// One frame in flight through the pipeline : the RAW packets and everything calculated from them
+struct PipelineFrame
+{
+	PressurePacket packet;
+	PressureData data;
+};
+
+
+// A stage calculation, e.g. acquire, decode, filter, features, events or a sink (print, save)
+typedef void (*PipelineFunction)(void* context, PipelineFrame* frame);
+
+
+// What the previous thread does when the queue in front of a stage is full
+enum QueuePolicy
+{
+	kQueueBlock,		// wait until the stage catches up (backpressure up to the acquisition)
+	kQueueDropNewest	// drop the new frame, e.g. for printing / display sinks
+};
+
+
+// Counters of one stage, see Pipeline::getStats()
+struct StageStats
+{
+	const char* name;
+	int group;
+	uint64_t processed;		// frames calculated
+	uint64_t dropped;		// frames dropped in front of this stage (kQueueDropNewest)
+	double throughput;		// processed frames per second since Start()
+	double mean_time;		// mean calculation time per frame (in seconds)
+	double max_time;		// max calculation time of a frame (in seconds)
+	int queue_size;			// frames waiting in front of this stage (1st stage of a group only)
+};
+
+
+/**
+* Staged processing of the foot-sensor frames on several threads
+*
+* Stages are added in processing order (acquire -> decode -> filter -> features -> events -> sinks)
+* and each one is assigned to a thread group. Consecutive stages of the same group run inline on one thread ;
+* groups are connected by bounded lock-free SPSC queues of frame indices, so no frame is copied nor allocated.
+* A fixed pool of frames circulates : the 1st group takes a free frame, the last group (or a drop) gives it back.
+*
+* The 1st stage is the source (e.g. FootSensor::ReadPressurePacket()), it paces the whole pipeline.
+* A group with nothing to do sleeps until the previous group hands it a frame (no spinning, also in real-time mode).
+* Each stage must only touch the state of its own group : e.g. every FootSensor method must always run in the same group.
+*/
+class Pipeline
+{
+public:
+	static const int max_stage = 16;
+	static const int max_group = 8;
+	static const int queue_size = 4;	// frames waiting in front of a group (power of two)
+	static const int num_frame = 64;	// frames of the pool (power of two), enough to fill all queues
+
+	Pipeline();
+	~Pipeline();
+
+	int AddStage(const char* name, PipelineFunction function, void* context, int group, QueuePolicy policy = kQueueBlock);
+
+	void setGroupCPU(int group, int cpu);
+
+	void setGroupRealTime(int group, const RealTimeConfig& config);
+
+	bool Start(const PressureData& initial_data);
+
+	void Stop();
+
+	bool isRunning() { return running.load(); }
+
+	int getNumStage() { return num_stage; }
+
+	void getStats(int stage, StageStats* stats);
+
+private:
+	struct Stage
+	{
+		const char* name;
+		PipelineFunction function;
+		void* context;
+		int group;
+		QueuePolicy policy;
+
+		std::atomic<uint64_t> processed;
+		std::atomic<uint64_t> dropped;
+		std::atomic<uint64_t> busy_ns;
+		std::atomic<uint64_t> max_ns;
+	};
+
+	Stage stage[max_stage];
+	int num_stage = 0;
+
+	int num_group = 0;
+	int group_first[max_group];			// 1st stage of each group
+	int group_cpu[max_group];			// -1 -> not pinned
+	bool group_realtime[max_group];
+	RealTimeConfig group_realtime_config[max_group];
+
+	PipelineFrame frame[num_frame];
+	SPSCQueue<int, queue_size> input_queue[max_group];	// frames waiting for group g (g > 0)
+	SPSCQueue<int, num_frame> free_queue[max_group];	// frames released by group g, back to group 0
+	WakeSignal group_signal[max_group];	// wakes group g up : frame in its input queue, room in the next queue, free frame (g = 0)
+
+	std::thread thread[max_group];
+	std::atomic<bool> running;
+	std::chrono::time_point<std::chrono::steady_clock> time_point_start;
+
+	void RunGroup(int group);
+
+	bool TakeFreeFrame(int* index);
+
+	bool hasFreeFrame();
+
+	void Forward(int group, int index);
+};
+
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,100 @@
+#include <cmath>
+
+#include "pressure_filter.hpp"
+
+
+PressureFilter::PressureFilter()
+{
+	for (int s = 0; s < max_section; s++)
+	{
+		z1[s].setZero();
+		z2[s].setZero();
+	}
+}
+
+
+/*
+@brief	Design the Butterworth low-pass cascade (bilinear transform, RBJ biquad form)
+
+An order-N Butterworth filter is split into N/2 biquad sections,
+section k has quality factor Q = 1 / (2 sin((2k+1) pi / 2N)).
+Odd orders are rounded up to the next even order.
+
+@param[in]	cutoff_hz	-3dB cut-off frequency of the low-pass filter
+@param[in]	sample_hz	sampling rate of the foot-sensor loop
+@param[in]	order		Butterworth order (2, 4, 6 or 8)
+*/
+void PressureFilter::Init(float cutoff_hz, float sample_hz, int order)
+{
+	n_section = (order + 1) / 2;
+	if (n_section < 1)
+		n_section = 1;
+	if (n_section > max_section)
+		n_section = max_section;
+
+	const double pi = 3.14159265358979323846;	// M_PI is not standard (MSVC needs _USE_MATH_DEFINES)
+	const int n_order = 2 * n_section;
+	const double w0 = 2.0 * pi * cutoff_hz / sample_hz;
+	const double cos_w0 = cos(w0);
+
+	for (int k = 0; k < n_section; k++)
+	{
+		double Q = 1.0 / (2.0 * sin((2 * k + 1) * pi / (2.0 * n_order)));
+		double alpha = sin(w0) / (2.0 * Q);
+		double a0 = 1.0 + alpha;
+
+		coeff[k].b0 = float((1.0 - cos_w0) / 2.0 / a0);
+		coeff[k].b1 = float((1.0 - cos_w0) / a0);
+		coeff[k].b2 = coeff[k].b0;
+		coeff[k].a1 = float(-2.0 * cos_w0 / a0);
+		coeff[k].a2 = float((1.0 - alpha) / a0);
+	}
+
+	primed = false;
+}
+
+
+/*
+@brief	Load the filter state as if the input had been constant forever
+
+Prevents the filter from ramping up from zero on the first reading.
+A low-pass biquad has unity DC gain, so steady-state output equals the input.
+
+@param[in]	cells	first reading of all pixels, in the lane layout of CellArray
+*/
+void PressureFilter::Prime(const CellArray& cells)
+{
+	for (int s = 0; s < n_section; s++)
+	{
+		z1[s] = cells * (1.0f - coeff[s].b0);
+		z2[s] = cells * (coeff[s].b2 - coeff[s].a2);
+	}
+	primed = true;
+}
+
+
+/*
+@brief	Advance every cell of both feet by one sample
+
+@param[in/out]	cells	raw pixels as input, filtered pixels as output
+*/
+void PressureFilter::Process(CellArray* cells)
+{
+	if (!primed)
+	{
+		Prime(*cells);
+		return;
+	}
+
+	CellArray& x = *cells;
+	for (int s = 0; s < n_section; s++)
+	{
+		const Section& c = coeff[s];
+
+		// y = b0*x + z1 ; z1 = b1*x - a1*y + z2 ; z2 = b2*x - a2*y
+		CellArray y = c.b0 * x + z1[s];
+		z1[s] = c.b1 * x - c.a1 * y + z2[s];
+		z2[s] = c.b2 * x - c.a2 * y;
+		x = y;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef PRESSURE_FILTER_HPP
+#define PRESSURE_FILTER_HPP
+
+#include "Eigen/Dense"
+
+
+/**
+* Low-pass Butterworth filter bank for every pixel of both foot-sensors
+*
+* The filter is a cascade of biquad sections (transposed direct form II).
+* Each section keeps its state as one fixed-size Eigen array holding ALL cells of BOTH feet,
+* so every line of the filter recursion is a single vectorised expression:
+* Eigen advances 4 (SSE), 8 (AVX) or 16 (AVX-512) cells per instruction.
+*
+* Lane layout of CellArray:
+* [0, 105)		-> left foot pixels (column-major, same order as PressureData::sensor_left.data())
+* [112, 217)	-> right foot pixels
+* the remaining lanes are padding so both halves start on a 64-byte boundary
+*/
+class PressureFilter
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	static const int n_cell = 105;			// pixels per foot (15 x 7)
+	static const int n_stride = 112;		// pixels per foot padded to a multiple of 16 floats
+	static const int n_lane = 2 * n_stride;	// lanes for both feet
+	static const int max_section = 4;		// up to 8th-order Butterworth
+
+	typedef Eigen::Array<float, n_lane, 1> CellArray;
+
+	PressureFilter();
+
+	void Init(float cutoff_hz, float sample_hz, int order);
+
+	void Prime(const CellArray& cells);
+
+	void Process(CellArray* cells);
+
+	bool isPrimed() { return primed; }
+
+private:
+	struct Section
+	{
+		float b0 = 1, b1 = 0, b2 = 0;
+		float a1 = 0, a2 = 0;
+	};
+
+	Section coeff[max_section];
+	CellArray z1[max_section];
+	CellArray z2[max_section];
+
+	int n_section = 0;
+	bool primed = false;
+};
+
+
+#endif // PRESSURE_FILTER_HPP
@@ -0,0 +1,57 @@
+#ifndef PRESSURE_FRAME_HPP
+#define PRESSURE_FRAME_HPP
+
+#include <stdint.h>
+
+
+/** Compact, fixed-size copy of one frame of both foot-sensors
+*
+* Plain-old-data (no Eigen, no pointers), so it can be copied with memcpy,
+* stored in history rings, shared memory or files.
+* Arrays are indexed by foot : [0] -> left ; [1] -> right
+* Pixels are in column-major order, same as PressureData::sensor_left.data()
+* There is no implicit padding : every byte is a member, so a packed frame is fully initialized.
+*/
+struct PressureFrame
+{
+	double time_stamp;			// in seconds, see PressureData::time_stamp
+	uint32_t seq;				// frame sequence number, see PressureData::frame_seq
+	uint16_t event_flags;		// bit (event - 1) -> left GaitEvent ; bit (event + 3) -> right GaitEvent
+	uint8_t gait_phase[2];		// GaitPhase
+	uint8_t contact_area[2];	// loaded pixels
+	uint8_t changed;			// bit 0 -> left pixels changed ; bit 1 -> right pixels changed (since the previous frame)
+	uint8_t reserved[5];
+
+	float pressure[2];			// pressure-sum
+	float cop_x[2];
+	float cop_y[2];
+	float pressure_grad[2];		// gradiant of the pressure-sum (per second)
+
+	uint16_t cells[2][105];		// RAW pixels
+	uint8_t reserved_end[4];	// explicit tail padding, zeroed : no uninitialized byte reaches a file, socket or shared memory
+};
+
+static_assert(sizeof(PressureFrame) == 480, "PressureFrame layout changed : update PressureFileVersion & the readers");
+
+// Header of a pressure-frame file (RealTimeFileIO::initPressure()), followed by one PressureFrame per frame
+struct PressureFileHeader
+{
+	char magic[4];				// PressureFileMagic
+	uint32_t version;			// PressureFileVersion
+	uint32_t record_size;		// sizeof(PressureFrame), to detect layout mismatch
+	uint32_t reserved;
+};
+
+static const char PressureFileMagic[4] = { 'F', 'S', 'P', '1' };
+static const uint32_t PressureFileVersion = 1;
+
+// Flag of a gait event in PressureFrame::event_flags
+inline uint16_t PressureFrameEventFlag(int foot, int event)
+{
+	if (event <= 0)
+		return 0;
+	return (uint16_t)(1u << ((event - 1) + 4 * (foot - 1)));	// foot : 1 -> left ; 2 -> right
+}
+
+
+#endif // PRESSURE_FRAME_HPP
@@ -0,0 +1,100 @@
+#include "pressure_map.hpp"
+
+
+PressureMap::PressureMap()
+{
+	Reset();
+}
+
+
+/*
+@brief	Clear all maps (step, last step and session)
+*/
+void PressureMap::Reset()
+{
+	prev.setZero();
+	step_peak.setZero();
+	step_pti.setZero();
+	last_step_peak.setZero();
+	last_step_pti.setZero();
+	session_peak.setZero();
+	session_pti.setZero();
+
+	prev_valid = false;
+	step_duration = 0;
+	session_duration = 0;
+}
+
+
+/*
+@brief	Accumulate one frame into the peak & PTI maps
+
+PTI uses the trapezoidal rule between the previous and current frame, with the real time interval.
+The very first frame only updates the peaks.
+
+@param[in]	pressure_mat	the matrix [15x7] of pixel-pressure
+@param[in]	time_stamp		time-stamp of the frame (in seconds)
+*/
+void PressureMap::Update(const Eigen::MatrixXi& pressure_mat, double time_stamp)
+{
+	CellArray curr = Eigen::Map<const Eigen::Array<int, n_cell, 1> >(pressure_mat.data()).cast<float>();
+
+	step_peak = step_peak.max(curr);
+	session_peak = session_peak.max(curr);
+
+	if (prev_valid)
+	{
+		float dt = float(time_stamp - time_stamp_prev);
+		CellArray area = (0.5f * dt) * (prev + curr);
+		step_pti += area;
+		session_pti += area;
+		step_duration += dt;
+		session_duration += dt;
+	}
+
+	prev = curr;
+	time_stamp_prev = time_stamp;
+	prev_valid = true;
+}
+
+
+/*
+@brief	Advance the time without accumulating, when the foot stays all zeros
+Same result as Update() with an all-zero frame, without decoding the pixels.
+
+@param[in]	time_stamp		time-stamp of the frame (in seconds)
+*/
+void PressureMap::Skip(double time_stamp)
+{
+	if (prev_valid)
+	{
+		float dt = float(time_stamp - time_stamp_prev);
+		if (!prev.isZero(0))
+		{
+			// Trapezoid down to the zero frame
+			CellArray area = (0.5f * dt) * prev;
+			step_pti += area;
+			session_pti += area;
+			prev.setZero();
+		}
+		step_duration += dt;
+		session_duration += dt;
+	}
+
+	time_stamp_prev = time_stamp;
+	prev_valid = true;
+}
+
+
+/*
+@brief	Close the current step (call at heel-strike)
+The step maps are kept as "last step" and cleared for the next step. Session maps continue.
+*/
+void PressureMap::NewStep()
+{
+	last_step_peak = step_peak;
+	last_step_pti = step_pti;
+	step_peak.setZero();
+	step_pti.setZero();
+	step_duration = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef PRESSURE_MAP_HPP
+#define PRESSURE_MAP_HPP
+
+#include "Eigen/Dense"
+
+
+/**
+* Incremental per-pixel peak-pressure and pressure-time-integral (PTI) maps of one foot-sensor
+*
+* Updated once per frame with the real frame time-stamps (trapezoidal integration),
+* so no frame has to be saved to compute them offline.
+* Maps are kept per step (reset by NewStep() at heel-strike) and over the whole session (reset by Reset()).
+* The last completed step is kept, so it can be read during the next step.
+*
+* All maps are readable at any time as [15x7] views, in the same layout as PressureData::sensor_left/right.
+*/
+class PressureMap
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	static const int n_row = 15;
+	static const int n_col = 7;
+	static const int n_cell = n_row * n_col;
+
+	typedef Eigen::Array<float, n_cell, 1> CellArray;
+	typedef Eigen::Map<const Eigen::Matrix<float, n_row, n_col> > CellMap;
+
+	PressureMap();
+
+	void Reset();
+
+	void Update(const Eigen::MatrixXi& pressure_mat, double time_stamp);
+
+	void Skip(double time_stamp);
+
+	void NewStep();
+
+	CellMap getStepPeak() const { return CellMap(step_peak.data()); }
+	CellMap getStepPTI() const { return CellMap(step_pti.data()); }
+	CellMap getLastStepPeak() const { return CellMap(last_step_peak.data()); }
+	CellMap getLastStepPTI() const { return CellMap(last_step_pti.data()); }
+	CellMap getSessionPeak() const { return CellMap(session_peak.data()); }
+	CellMap getSessionPTI() const { return CellMap(session_pti.data()); }
+
+	double getStepDuration() const { return step_duration; }
+	double getSessionDuration() const { return session_duration; }
+
+private:
+	CellArray prev;				// pixels of the previous frame
+	CellArray step_peak;
+	CellArray step_pti;			// pressure x seconds
+	CellArray last_step_peak;
+	CellArray last_step_pti;
+	CellArray session_peak;
+	CellArray session_pti;
+
+	double time_stamp_prev = 0;
+	bool prev_valid = false;
+	double step_duration = 0;
+	double session_duration = 0;
+};
+
+
+#endif // PRESSURE_MAP_HPP
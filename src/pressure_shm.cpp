@@ -0,0 +1,267 @@
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "pressure_shm.hpp"
+
+
+PressureShmWriter::~PressureShmWriter()
+{
+	Close();
+}
+
+
+/*
+@brief	Create (or re-create) the shared memory segment
+
+@param[in]	name		POSIX shared memory name, e.g. "/foot_sensor"
+@param[in]	history		number of frames kept, rounded up to a power of two
+@return	false if the segment cannot be created (or not on POSIX)
+*/
+bool PressureShmWriter::Open(const char* name, int history)
+{
+	Close();
+
+#if defined(__unix__)
+	uint32_t num_slot = 1;
+	while ((int)num_slot < history)
+		num_slot <<= 1;
+
+	size = sizeof(PressureShmHeader) + num_slot * sizeof(PressureShmSlot);
+
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+	if (fd < 0)
+	{
+		std::cerr << "PressureShmWriter: shm_open " << name << " failed (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+	if (ftruncate(fd, size) != 0)
+	{
+		std::cerr << "PressureShmWriter: ftruncate failed (" << strerror(errno) << ")" << std::endl;
+		close(fd);
+		return false;
+	}
+
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		std::cerr << "PressureShmWriter: mmap failed (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+
+	// Readers only accept the segment once the magic is set
+	memset(memory, 0, size);
+	header = static_cast<PressureShmHeader*>(memory);
+	slot = reinterpret_cast<PressureShmSlot*>(static_cast<char*>(memory) + sizeof(PressureShmHeader));
+	header->frame_size = sizeof(PressureFrame);
+	header->history = num_slot;
+	header->write_count.store(0);
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = PressureShmMagic;
+
+	strncpy(this->name, name, sizeof(this->name) - 1);
+	count = 0;
+	return true;
+#else
+	std::cerr << "PressureShmWriter: POSIX shared memory is not available" << std::endl;
+	return false;
+#endif
+}
+
+
+/*
+@brief	Unmap & remove the segment (readers still mapping it keep their copy until they close)
+*/
+void PressureShmWriter::Close()
+{
+#if defined(__unix__)
+	if (header)
+	{
+		munmap(header, size);
+		shm_unlink(name);
+	}
+#endif
+	header = NULL;
+	slot = NULL;
+}
+
+
+/*
+@brief	Publish one frame, never waits for the readers (seqlock write of the next slot)
+*/
+void PressureShmWriter::Publish(const PressureFrame& frame)
+{
+	if (!header)
+		return;
+
+	PressureShmSlot& s = slot[count & (header->history - 1)];
+
+	s.version.store(2 * count + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&s.frame, &frame, sizeof(PressureFrame));
+	s.version.store(2 * count + 2, std::memory_order_release);
+
+	count++;
+	header->write_count.store(count, std::memory_order_release);
+}
+
+
+PressureShmReader::~PressureShmReader()
+{
+	Close();
+}
+
+
+/*
+@brief	Map an existing segment, read-only
+
+@param[in]	name	POSIX shared memory name, same as PressureShmWriter::Open()
+@return	false if the segment does not exist (yet) or has another layout
+*/
+bool PressureShmReader::Open(const char* name)
+{
+	Close();
+
+#if defined(__unix__)
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(PressureShmHeader))
+	{
+		close(fd);
+		return false;
+	}
+	size = info.st_size;
+
+	void* memory = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+		return false;
+
+	const PressureShmHeader* h = static_cast<const PressureShmHeader*>(memory);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (h->magic != PressureShmMagic || h->frame_size != sizeof(PressureFrame)
+		|| size < sizeof(PressureShmHeader) + h->history * sizeof(PressureShmSlot))
+	{
+		std::cerr << "PressureShmReader: " << name << " is not a foot-sensor segment of this version" << std::endl;
+		munmap(memory, size);
+		return false;
+	}
+
+	header = h;
+	slot = reinterpret_cast<const PressureShmSlot*>(static_cast<const char*>(memory) + sizeof(PressureShmHeader));
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+/*
+@brief	Unmap the segment
+*/
+void PressureShmReader::Close()
+{
+#if defined(__unix__)
+	if (header)
+		munmap(const_cast<PressureShmHeader*>(header), size);
+#endif
+	header = NULL;
+	slot = NULL;
+}
+
+
+/*
+@brief	Number of frames published so far (the latest frame has index getWriteCount() - 1)
+*/
+uint64_t PressureShmReader::getWriteCount()
+{
+	return header ? header->write_count.load(std::memory_order_acquire) : 0;
+}
+
+
+/*
+@brief	Copy frame number "index" (0 -> 1st frame published)
+
+@return	false if it is not published yet, or already overwritten (older than the history)
+*/
+bool PressureShmReader::Read(uint64_t index, PressureFrame* frame)
+{
+	if (!header)
+		return false;
+
+	const PressureShmSlot& s = slot[index & (header->history - 1)];
+
+	uint64_t version = s.version.load(std::memory_order_acquire);
+	if (version != 2 * index + 2)
+		return false;
+
+	memcpy(frame, &s.frame, sizeof(PressureFrame));
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	// Rewritten while copying -> the copy may be torn
+	return s.version.load(std::memory_order_relaxed) == version;
+}
+
+
+/*
+@brief	Copy the latest frame
+
+@param[out]	frame	the latest frame
+@param[out]	index	its index, to detect new frames (optional)
+@return	false if no frame is published yet
+*/
+bool PressureShmReader::ReadLatest(PressureFrame* frame, uint64_t* index)
+{
+	for (int retry = 0; retry < 16; retry++)
+	{
+		uint64_t count = getWriteCount();
+		if (count == 0)
+			return false;
+
+		if (Read(count - 1, frame))
+		{
+			if (index)
+				*index = count - 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+@brief	Copy the last num_frame frames, oldest first
+
+@param[in]	num_frame	frames wanted (at most the history minus one, the slot being written is skipped)
+@param[out]	frames		array of num_frame frames
+@return	number of frames copied
+*/
+int PressureShmReader::ReadHistory(int num_frame, PressureFrame* frames)
+{
+	if (!header)
+		return 0;
+
+	uint64_t count = getWriteCount();
+	uint64_t available = (count < header->history) ? count : header->history - 1;
+	if ((uint64_t)num_frame > available)
+		num_frame = (int)available;
+
+	int num_copied = 0;
+	for (uint64_t index = count - num_frame; index < count; index++)
+	{
+		if (Read(index, &frames[num_copied]))
+			num_copied++;
+	}
+	return num_copied;
+}
@@ -0,0 +1,94 @@
+#ifndef PRESSURE_SHM_HPP
+#define PRESSURE_SHM_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include "pressure_frame.hpp"
+
+
+/** Cross-process publication of the foot-sensor frames in POSIX shared memory
+*
+* The acquisition process writes every PressureFrame with PressureShmWriter ;
+* other processes (e.g. the exoskeleton controller) read them with PressureShmReader,
+* without linking FootSensor nor owning the serial ports. Reading a frame costs a memcpy.
+*
+* The segment holds a ring of the last "history" frames in versioned slots (seqlock per slot) :
+* the writer never waits for readers, a reader retries if the slot was rewritten while it was copying.
+* Only pressure_frame.hpp, pressure_shm.hpp & pressure_shm.cpp are needed by a reader (library pressure_shm).
+*/
+
+
+// Layout of the shared memory segment : header, then "history" slots
+struct PressureShmHeader
+{
+	uint32_t magic;				// PressureShmMagic once the segment is initialized
+	uint32_t frame_size;		// sizeof(PressureFrame), to detect layout mismatch
+	uint32_t history;			// number of slots (power of two)
+	uint32_t reserved;
+	alignas(64) std::atomic<uint64_t> write_count;	// frames published so far ; the latest is write_count - 1
+};
+
+struct PressureShmSlot
+{
+	alignas(64) std::atomic<uint64_t> version;	// 2n + 1 while frame n is written, 2n + 2 once written
+	PressureFrame frame;
+};
+
+static const uint32_t PressureShmMagic = 0x46534D31;	// "FSM1"
+
+
+// Publishes frames : one writer process per segment
+class PressureShmWriter
+{
+public:
+	~PressureShmWriter();
+
+	bool Open(const char* name = "/foot_sensor", int history = 256);
+
+	void Close();
+
+	void Publish(const PressureFrame& frame);
+
+	bool isOpen() { return header != NULL; }
+
+private:
+	char name[64] = { 0 };
+	PressureShmHeader* header = NULL;
+	PressureShmSlot* slot = NULL;
+	size_t size = 0;
+	uint64_t count = 0;
+};
+
+
+// Reads frames, never blocks the writer : any number of reader processes
+class PressureShmReader
+{
+public:
+	~PressureShmReader();
+
+	bool Open(const char* name = "/foot_sensor");
+
+	void Close();
+
+	uint64_t getWriteCount();
+
+	bool Read(uint64_t index, PressureFrame* frame);
+
+	bool ReadLatest(PressureFrame* frame, uint64_t* index = NULL);
+
+	int ReadHistory(int num_frame, PressureFrame* frames);
+
+	bool isOpen() { return header != NULL; }
+
+	int getHistory() { return header ? (int)header->history : 0; }
+
+private:
+	const PressureShmHeader* header = NULL;
+	const PressureShmSlot* slot = NULL;
+	size_t size = 0;
+};
+
+
+#endif // PRESSURE_SHM_HPP
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#elif defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#endif
+
+#include "realtime_thread.hpp"
+
+
+/*
+@brief	Switch the calling thread to real-time mode, then run the jitter self-test
+
+Order matters : memory is locked before the stack is pre-faulted, so the touched pages stay resident.
+The buffer of the self-test is allocated first, by this thread, so several threads can run it at the same time.
+
+@param[in]	config	settings to apply
+@param[out]	status	settings actually applied & measured jitter
+
+@return	true if all requested settings were applied
+*/
+bool RealTimeThread::Apply(const RealTimeConfig& config, RealTimeStatus* status)
+{
+	*status = RealTimeStatus();
+	bool all_applied = true;
+
+	std::vector<float> lateness(std::max(0, std::min(config.self_test_loops, (int)max_self_test_loops)));
+
+#if defined(__linux__)
+	if (config.lock_memory)
+	{
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			status->memory_locked = true;
+		else
+		{
+			std::cerr << "RealTimeThread: mlockall failed (" << strerror(errno) << "), memory is not locked" << std::endl;
+			all_applied = false;
+		}
+	}
+
+	if (config.cpu >= 0)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(config.cpu, &cpu_set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0)
+			status->pinned = true;
+		else
+		{
+			std::cerr << "RealTimeThread: cannot pin to CPU " << config.cpu << std::endl;
+			all_applied = false;
+		}
+	}
+
+	if (config.use_fifo)
+	{
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = std::min(std::max(config.priority, sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+		int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (error == 0)
+			status->fifo = true;
+		else
+		{
+			std::cerr << "RealTimeThread: SCHED_FIFO failed (" << strerror(error) << "), running as SCHED_OTHER" << std::endl;
+			all_applied = false;
+		}
+	}
+#elif defined(_WIN32) || defined(WIN32)
+	if (config.cpu >= 0)
+	{
+		status->pinned = SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << config.cpu) != 0;
+		all_applied = all_applied && status->pinned;
+	}
+
+	if (config.use_fifo)
+	{
+		status->fifo = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+		all_applied = all_applied && status->fifo;
+	}
+
+	if (config.lock_memory)
+	{
+		std::cerr << "RealTimeThread: memory locking is not supported on Windows" << std::endl;
+		all_applied = false;
+	}
+#endif
+
+	if (config.prefault_stack > 0)
+	{
+		PrefaultStack(std::min(config.prefault_stack, (int)max_prefault_stack));
+		status->stack_prefaulted = true;
+	}
+
+	if (config.self_test_loops > 0)
+		MeasureJitter(config.self_test_loops, config.self_test_period, lateness.data(), status);
+
+	return all_applied;
+}
+
+
+/*
+@brief	Sleep on absolute deadlines & measure how late the calling thread wakes up
+
+@param[in]	loops		number of wake-ups (<= max_self_test_loops)
+@param[in]	period		period between deadlines (in seconds)
+@param[out]	lateness	buffer of (at least) loops elements, owned by the calling thread & allocated before it runs real-time
+@param[out]	status		jitter_mean, jitter_max & jitter_p99
+*/
+void RealTimeThread::MeasureJitter(int loops, double period, float* lateness, RealTimeStatus* status)
+{
+	loops = std::min(loops, (int)max_self_test_loops);
+
+	double total = 0;
+	double max = 0;
+
+#if defined(__linux__)
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	long period_ns = long(period * 1e9);
+
+	for (int i = 0; i < loops; i++)
+	{
+		deadline.tv_nsec += period_ns;
+		while (deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_nsec -= 1000000000L;
+			deadline.tv_sec++;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double late = double(now.tv_sec - deadline.tv_sec) + 1e-9 * double(now.tv_nsec - deadline.tv_nsec);
+#else
+	auto deadline = std::chrono::steady_clock::now();
+	auto period_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(period));
+
+	for (int i = 0; i < loops; i++)
+	{
+		deadline += period_duration;
+		std::this_thread::sleep_until(deadline);
+		double late = std::chrono::duration<double>(std::chrono::steady_clock::now() - deadline).count();
+#endif
+		lateness[i] = float(late);
+		total += late;
+		if (late > max)
+			max = late;
+	}
+
+	status->num_wakeup = loops;
+	status->jitter_mean = (loops > 0) ? total / loops : 0;
+	status->jitter_max = max;
+
+	if (loops > 0)
+	{
+		int p99 = (loops * 99) / 100;
+		std::nth_element(lateness, lateness + p99, lateness + loops);
+		status->jitter_p99 = lateness[p99];
+	}
+}
+
+
+/*
+@brief	Print the applied settings & the self-test result
+*/
+void RealTimeThread::Print(const RealTimeStatus& status)
+{
+	std::cout << "Real-time : FIFO " << status.fifo << "\tpinned " << status.pinned
+		<< "\tmemory locked " << status.memory_locked << "\tstack pre-faulted " << status.stack_prefaulted << std::endl;
+	if (status.num_wakeup > 0)
+		std::cout << "Wake-up jitter over " << status.num_wakeup << " loops : mean " << status.jitter_mean * 1e6
+			<< " us\tp99 " << status.jitter_p99 * 1e6 << " us\tmax " << status.jitter_max * 1e6 << " us" << std::endl;
+}
+
+
+#if defined(_MSC_VER)
+#define REALTIME_NOINLINE __declspec(noinline)
+#else
+#define REALTIME_NOINLINE __attribute__((noinline))
+#endif
+
+/*
+@brief	Touch one page of stack per call, num_page calls deep
+Each call has its own small frame (one page), so the stack only grows as far as requested.
+*/
+static REALTIME_NOINLINE void TouchStackPage(int num_page)
+{
+	volatile unsigned char page[4096];
+	page[0] = 0;
+	page[sizeof(page) - 1] = 0;
+	if (num_page > 1)
+		TouchStackPage(num_page - 1);
+	page[0] = page[sizeof(page) - 1];	// used after the call : no tail call reusing this frame
+}
+
+
+/*
+@brief	Touch size bytes of stack, so the pages are mapped (and locked) before the hot path needs them
+This is an internal function.
+*/
+void RealTimeThread::PrefaultStack(int size)
+{
+	TouchStackPage((size + 4095) / 4096);
+}
@@ -0,0 +1,59 @@
+#ifndef REALTIME_THREAD_HPP
+#define REALTIME_THREAD_HPP
+
+
+// Opt-in real-time settings of the thread that services USBStream & FootSensor
+struct RealTimeConfig
+{
+	bool use_fifo = true;			// SCHED_FIFO (Linux) / time-critical priority (Windows)
+	int priority = 80;				// SCHED_FIFO priority, 1 (lowest) .. 99
+	int cpu = -1;					// CPU core to pin the thread to, -1 -> not pinned
+	bool lock_memory = true;		// mlockall() current & future pages, no page fault on the hot path
+	int prefault_stack = 256 * 1024;	// bytes of stack touched in advance (<= RealTimeThread::max_prefault_stack)
+
+	int self_test_loops = 1000;		// wake-ups of the jitter self-test, 0 -> no self-test
+	double self_test_period = 1e-3;	// period of the self-test wake-ups (in seconds)
+};
+
+
+// What could actually be applied (without privileges, some settings fall back) & the measured jitter
+struct RealTimeStatus
+{
+	bool fifo = false;
+	bool pinned = false;
+	bool memory_locked = false;
+	bool stack_prefaulted = false;
+
+	int num_wakeup = 0;
+	double jitter_mean = 0;			// late wake-up, in seconds
+	double jitter_max = 0;
+	double jitter_p99 = 0;
+};
+
+
+/**
+* Real-time mode of the CALLING thread : SCHED_FIFO priority, CPU affinity, locked memory & pre-faulted stack
+*
+* Every setting is best-effort : without privileges (e.g. no CAP_SYS_NICE / RLIMIT_RTPRIO / RLIMIT_MEMLOCK)
+* a warning is printed and the thread keeps running as a normal thread.
+* The self-test sleeps on absolute deadlines and reports how late the thread wakes up,
+* which is what a fixed-rate controller sees as tail latency.
+*/
+class RealTimeThread
+{
+public:
+	static const int max_prefault_stack = 256 * 1024;	// well below the smallest default stack (1 MB on Windows)
+	static const int max_self_test_loops = 10000;
+
+	static bool Apply(const RealTimeConfig& config, RealTimeStatus* status);
+
+	static void MeasureJitter(int loops, double period, float* lateness, RealTimeStatus* status);
+
+	static void Print(const RealTimeStatus& status);
+
+private:
+	static void PrefaultStack(int size);
+};
+
+
+#endif // REALTIME_THREAD_HPP
@@ -2,8 +2,11 @@
 #include <istream>
 #include <stdexcept>
 #include <ctime> // for getting time date
+#include <cstring>
+#include <cstdio>
 
 #include "realtimefile_io.hpp"
+#include "trace.hpp"
 #include "variable_conversion.hpp"
 
 
@@ -158,25 +161,31 @@ void RealTimeFileIO::writeToFileIMUBinary(IMUStore* data, float *extra_data)
 
 		const int numdata = 11; // 3 for accel, 3 for gyro, 4 for quat, 1 for timestamp
 		int datasize = numdata * 4 + 1; // add 1 for button state, add multiples of 4 for extra_columns
+		async_writer.Stop();
 		newFileBinary(datasize);
+		startAsync();
 	}
 
-	// write IMU data
+	// format the row, then write it at once
 	rowcount++;
+	char* row = row_buffer.data();
+	int n = 0;
 	for (int k = 0; k < num_imu; k++)
 	{
-		realtimefile.write(data[k].rawdata, data[k].rawdatasize);
-		realtimefile.write(" ", 1);
+		memcpy(row + n, data[k].rawdata, data[k].rawdatasize);
+		n += data[k].rawdatasize;
+		row[n++] = ' ';
 	}
 	for (int k = 0; k < extra_col; k++)
 	{
-		char temp[4];
-		varc.Float2Char(extra_data[k], temp);
-		realtimefile.write(temp, sizeof(float));
-		realtimefile.write(" ", 1);
+		varc.Float2Char(extra_data[k], row + n);
+		n += sizeof(float);
+		row[n++] = ' ';
 	}
-	realtimefile.write("\n\r", 2);
-	
+	row[n++] = '\n';
+	row[n++] = '\r';
+
+	writeRow(row, n);
 }
 
 /** @brief Open a new text file and write the standard headers
@@ -293,24 +302,81 @@ void RealTimeFileIO::writeToFileIMU(IMUStore* data, float *extra_data)
 	if (realtimefile.is_open() == false)
 	{
 		printf("Failed to open %s (maybe missing data folder). Reopening File.\n", realtimefilename.c_str());
+		async_writer.Stop();
 		newFileASCII();
+		startAsync();
 	}
 
-	// write IMU data
+	// format the row (same format as the file stream : scientific, precision 8), then write it at once
 	rowcount++;
+	char* row = row_buffer.data();
+	int n = 0;
 	for (int k = 0; k < num_imu; k++)
 	{
-		realtimefile << data[k].interval << " ";
-		realtimefile << data[k].accel(0) << " " << data[k].accel(1) << " " << data[k].accel(2) << " ";
-		realtimefile << data[k].gyro(0) << " " << data[k].gyro(1) << " " << data[k].gyro(2) << " ";
-		realtimefile << data[k].quat.w() << " " << data[k].quat.x() << " " << data[k].quat.y() << " " << data[k].quat.z() << " ";
+		n += sprintf(row + n, "%u ", data[k].interval);
+		n += sprintf(row + n, "%.8e %.8e %.8e ", data[k].accel(0), data[k].accel(1), data[k].accel(2));
+		n += sprintf(row + n, "%.8e %.8e %.8e ", data[k].gyro(0), data[k].gyro(1), data[k].gyro(2));
+		n += sprintf(row + n, "%.8e %.8e %.8e %.8e ", data[k].quat.w(), data[k].quat.x(), data[k].quat.y(), data[k].quat.z());
 		//data[k].printIMUData();
 	}
 	for (int k = 0; k < extra_col; k++)
 	{
-		realtimefile << extra_data[k] << " ";
+		n += sprintf(row + n, "%.8e ", extra_data[k]);
 	}
-	realtimefile.write("\n", 1);
+	row[n++] = '\n';
+
+	writeRow(row, n);
+}
+
+/** @brief Write one formatted row, directly or through the writer thread (asynchronous mode)
+ *
+ * @param[in] row the formatted row
+ * @param[in] size bytes of the row
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::writeRow(const char* row, int size)
+{
+	if (use_async)
+		async_writer.Write(row, size);
+	else
+		realtimefile.write(row, size);
+}
+
+/** @brief Select the asynchronous mode, before init()
+ *
+ * In asynchronous mode, save() only formats the row and queues it in a lock-free ring ;
+ * a background thread writes the queued rows in large blocks, so disk hiccups never reach the caller.
+ * The file headers & footers are still written by init(), newfile() & end(), after the queued rows.
+ *
+ * @param[in] use_async true -> asynchronous mode ; false -> rows are written by save() (default)
+ * @param[in] policy what save() does when the ring is full : drop the row (default) or wait
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::setAsync(bool use_async, WritePolicy policy)
+{
+	this->use_async = use_async;
+	this->async_policy = policy;
+}
+
+/** @brief Get the counters of the asynchronous mode (queue depth, dropped rows, block write time)
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::getAsyncStats(AsyncWriterStats* stats)
+{
+	async_writer.getStats(stats);
+}
+
+/** @brief Start the writer thread on the current file, in asynchronous mode
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::startAsync()
+{
+	if (use_async)
+		async_writer.Start(&realtimefile, async_policy);
 }
 
 /** @brief Initialize the file
@@ -324,11 +390,18 @@ void RealTimeFileIO::writeToFileIMU(IMUStore* data, float *extra_data)
  */
 void RealTimeFileIO::init(bool write_binary, IMUStore* data)
 {
+	// the rows still queued belong to the previous file
+	async_writer.Stop();
+
+	// largest row : 46 bytes per IMU & 5 per extra column in binary, at most 24 characters per value in text
+	row_buffer.resize(num_imu * 11 * 24 + extra_col * 24 + 2);
+
 	imu_placement = 0;
 	for (int i = 0; i < num_imu; i++)
 		imu_placement += data[i].position * pow(10, num_imu - 1 - i);//creates an int value that indicates the imu_placement order
 
 	this->write_binary = write_binary;
+	this->write_pressure = false;
 	if (write_binary)
 	{
 		int datasize = 0;
@@ -343,6 +416,88 @@ void RealTimeFileIO::init(bool write_binary, IMUStore* data)
 	{
 		newFileASCII();
 	}
+
+	startAsync();
+}
+
+/** @brief Open a new pressure-frame file and write its header
+ *
+ * The file is stored with the following format: \n
+ * a PressureFileHeader (magic "FSP1", version, record size) \n
+ * then one PressureFrame per frame (RAW cells of both feet as uint16, derived scalars, time-stamp, sequence number & event flags), \n
+ * each written as one contiguous block, in the byte order of this machine, without separator \n
+ * The number of frames is (file size - header size) / record size, so a file cut short by a crash stays readable.
+ *
+ * @see MatrixIO::readPressureFrames()
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::newFilePressure()
+{
+	if (realtimefile.is_open() == true)
+	{
+		realtimefile.close();
+		filecount++;
+	}
+	else
+	{
+		filecount = 1;
+	}
+	rowcount = 0;
+	realtimefilename = getSaveString();
+	realtimefilename = realtimefilename + append_filename;
+	printf("New file: %s\n", realtimefilename.c_str());
+	realtimefile.open("../data/" + realtimefilename + "_pressure.bin", std::ios::out | std::ios::trunc | std::ios::binary);
+
+	PressureFileHeader header;
+	memcpy(header.magic, PressureFileMagic, sizeof(header.magic));
+	header.version = PressureFileVersion;
+	header.record_size = sizeof(PressureFrame);
+	header.reserved = 0;
+	realtimefile.write((char*)&header, sizeof(header));
+}
+
+/** @brief Initialize a pressure-frame file (instead of an IMU file)
+ *
+ * Open a new file OR close the previous file, iterate the filecount and open a new file \n
+ * Frames are then saved with savePressure(), synchronously or in asynchronous mode (see setAsync()).
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::initPressure()
+{
+	// the frames still queued belong to the previous file
+	async_writer.Stop();
+
+	write_pressure = true;
+	newFilePressure();
+
+	startAsync();
+}
+
+/** @brief save one frame of both foot-sensors
+ *
+ * The compact frame (see FootSensor::PackFrame()) is written as one block of sizeof(PressureFrame) bytes,
+ * e.g. 480 bytes instead of 210 pressure values as float extra columns (1050 bytes, each byte-swapped).
+ *
+ * @param[in] frame the frame to be saved (must use initPressure before)
+ *
+ * @return returns nothing
+ */
+void RealTimeFileIO::savePressure(const PressureFrame& frame)
+{
+	TRACE_SCOPE("RealTimeFileIO::savePressure");
+
+	if (realtimefile.is_open() == false)
+	{
+		printf("Failed to open %s (maybe missing data folder). Reopening File.\n", realtimefilename.c_str());
+		async_writer.Stop();
+		newFilePressure();
+		startAsync();
+	}
+
+	rowcount++;
+	writeRow((const char*)&frame, sizeof(PressureFrame));
 }
 
 /** @brief save the IMU data
@@ -356,6 +511,8 @@ void RealTimeFileIO::init(bool write_binary, IMUStore* data)
  */
 void RealTimeFileIO::save(IMUStore* data, float *extra_data)
 {
+	TRACE_SCOPE("RealTimeFileIO::save");
+
 	if(write_binary)
 		writeToFileIMUBinary(data, extra_data);
 	else
@@ -370,7 +527,10 @@ void RealTimeFileIO::save(IMUStore* data, float *extra_data)
  */
 void RealTimeFileIO::newfile(IMUStore* data)
 {
-	init(write_binary, data);
+	if (write_pressure)
+		initPressure();
+	else
+		init(write_binary, data);
 }
 
 /** @brief Close all files
@@ -381,9 +541,16 @@ void RealTimeFileIO::newfile(IMUStore* data)
  */
 void RealTimeFileIO::end()
 {
+	// write the rows still queued before the footer
+	async_writer.Stop();
+
 	if (realtimefile.is_open() == true)
 	{
-		if (write_binary == true)
+		if (write_pressure == true)
+		{
+			// no footer : the number of frames is given by the file size
+		}
+		else if (write_binary == true)
 		{
 			char temp[4];
 			memcpy(temp, (char*)&rowcount, sizeof(unsigned int)); // store the row count as the last value in little endian format
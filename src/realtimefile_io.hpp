@@ -2,11 +2,14 @@
 #define REALTIMEFILE_IO_H_
 
 #include <string>
+#include <vector>
 #include <Eigen/Core>
 #include <iostream>
 #include <fstream>
 #include "variable_conversion.hpp"
 #include "imu_store.hpp"
+#include "async_file_writer.hpp"
+#include "pressure_frame.hpp"
 
 #ifdef useIMU
 #include "imu_data_manipulation.hpp"
@@ -33,6 +36,7 @@ private:
 
 	/////////////////// Real time IO ////////////////////
 	bool write_binary = false;
+	bool write_pressure = false; // the file holds PressureFrame records (initPressure()), not IMU rows
 	std::ofstream realtimefile; //file to be saved in realtime
 	std::string realtimefilename; // filename of the current savefile
 	std::string append_filename;
@@ -41,11 +45,20 @@ private:
 	int extra_col = 0; // number of extra columns to add
 	std::string extra_col_header = ""; //header of the extra cols
 
+	/////////////////// Asynchronous IO ////////////////////
+	bool use_async = false; // rows are queued & written by a background thread
+	WritePolicy async_policy = kWriteDrop;
+	AsyncFileWriter async_writer;
+	std::vector<char> row_buffer; // one row, formatted before it is written (or queued) at once
+
 	void newFileBinary(int datasize);
 	void newFileASCII();
+	void newFilePressure();
 
 	void writeToFileIMUBinary(IMUStore* data, float *extra_data);
 	void writeToFileIMU(IMUStore* data, float *extra_data);
+	void writeRow(const char* row, int size);
+	void startAsync();
 
 	std::string getSaveString();
 
@@ -56,6 +69,10 @@ public:
 	RealTimeFileIO(std::string append_filename_ = "");
 	void init(bool write_binary, IMUStore* data);
 	void save(IMUStore* data, float* extra_data = NULL);
+	void initPressure();
+	void savePressure(const PressureFrame& frame);
+	void setAsync(bool use_async, WritePolicy policy = kWriteDrop);
+	void getAsyncStats(AsyncWriterStats* stats);
 	void newfile(IMUStore* data);
 
 	~RealTimeFileIO() 
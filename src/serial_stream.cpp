@@ -1,4 +1,7 @@
+#include <cstring>
+
 #include "serial_stream.hpp"
+#include "trace.hpp"
 
 
 USBStream::USBStream(bool use_overlapped)
@@ -160,6 +163,9 @@ int USBStream::Open(const char* device)
 		USBStreamHandle.SetStopBits(getStopBits(stopbit));
 		USBStreamHandle.SetFlowControl(getFlowControl(flowcontrol));
 
+		write_buffer.reserve(64);
+		read_buffer.reserve(512);
+
 	#endif
 
 	return flag;
@@ -194,6 +200,8 @@ bool USBStream::good()
 
 void USBStream::write(char* buffer, int len)
 {
+	TRACE_SCOPE_ARG("USBStream::write", len);
+
 	#if defined(_WIN32) || defined(WIN32)
 	if (use_overlapped == true)
 	{
@@ -237,18 +245,16 @@ void USBStream::write(char* buffer, int len)
 	////////////// Method 3 ///////////////////
 	// printf("isOpen: %d\n", USBStreamHandle.IsOpen());
 	// printf("isDataAvailable: %d\n", USBStreamHandle.IsDataAvailable());
-	std::vector<uint8_t> tbuffer;
-	for(int i=0; i<len; i++)
-	{
-		tbuffer.push_back((uint8_t) buffer[i]);
-	}
-	USBStreamHandle.Write(tbuffer);
+	write_buffer.assign((uint8_t*) buffer, (uint8_t*) buffer + len);
+	USBStreamHandle.Write(write_buffer);
 
 	#endif
 }
 
 int USBStream::read(char* buffer)
 {
+	TRACE_SCOPE("USBStream::read");
+
 	#if defined(_WIN32) || defined(WIN32)
 	if (use_overlapped == true)
 	{
@@ -358,24 +364,22 @@ int USBStream::read(char* buffer)
 
 int USBStream::read(char* buffer, int len, int timeout)
 {
+	TRACE_SCOPE_ARG("USBStream::read", len);
+
 	#if defined(_WIN32) || defined(WIN32)
 	unsigned long nbr = 0; //number of bytes that is read out
 	ReadFile(USBStreamHandle, buffer, len, &nbr, NULL);
 	return (int)nbr;
 
 	#elif defined(__unix__)
-	LibSerial::DataBuffer data;
 	// std::string str="";
 	try
 	{
-	USBStreamHandle.Read(data, len, timeout);
-	for (int i = 0; i < len; i++)
-	{
-		buffer[i] = data[i];
-	}
+	USBStreamHandle.Read(read_buffer, len, timeout);
+	memcpy(buffer, read_buffer.data(), len);
 	return len;
 	}
-	catch (LibSerial::ReadTimeout e)
+	catch (LibSerial::ReadTimeout& e)
 	{
 		return 0;
 	}
@@ -20,6 +20,8 @@
 #include <stdio.h>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 #if defined(__unix__)
 
@@ -69,6 +71,10 @@ private:
 
 	LibSerial::SerialPort USBStreamHandle;
 
+	// Reused by write() & read(buffer, len), no allocation per call once they reached the packet size
+	std::vector<uint8_t> write_buffer;
+	LibSerial::DataBuffer read_buffer;
+
 #endif
 
 public:
@@ -0,0 +1,294 @@
+#include "session_manager.hpp"
+
+
+SessionManager::SessionManager() : running(false)
+{
+}
+
+
+SessionManager::~SessionManager()
+{
+	Stop();
+	for (int i = 0; i < num_subject; i++)
+		delete subject[i];
+}
+
+
+/*
+@brief	Add a subject (one insole pair), before Start()
+
+@param[in]	name			name of the subject, for the reports
+@param[in]	comport_left	serial port of the left foot-sensor (see FootSensor::OpenSerialPort())
+@param[in]	comport_right	serial port of the right foot-sensor
+@return	id of the subject, -1 if full or running
+*/
+int SessionManager::AddSubject(const std::string& name, const std::string& comport_left, const std::string& comport_right)
+{
+	if (running.load() || num_subject >= max_subject)
+	{
+		std::cerr << "SessionManager: cannot add subject " << name << std::endl;
+		return -1;
+	}
+
+	Subject* s = new Subject;
+	s->name = name;
+	s->comport[0] = comport_left;
+	s->comport[1] = comport_right;
+	subject[num_subject] = s;
+	return num_subject++;
+}
+
+
+/*
+@brief	Open the ports of all subjects, start one reader per subject & the worker pool
+A subject whose ports cannot be opened is left inactive, the others still run.
+
+@param[in]	num_worker	number of worker threads, 0 -> one per hardware thread (at most one per subject)
+@return	false if running or no subject could be opened
+*/
+bool SessionManager::Start(int num_worker)
+{
+	if (running.load() || num_subject == 0)
+		return false;
+
+	int num_active = 0;
+	for (int i = 0; i < num_subject; i++)
+	{
+		Subject* s = subject[i];
+		s->active = s->foot_sensor.OpenSerialPort(s->serial_port, s->comport[0].c_str(), s->comport[1].c_str());
+		if (!s->active)
+			std::cerr << "SessionManager: subject " << s->name << " is inactive" << std::endl;
+		else
+			num_active++;
+
+		s->queue.Clear();
+		s->frames = 0;
+		s->dropped = 0;
+		s->timeouts = 0;
+		s->heel_strikes = 0;
+		s->read_ns = 0;
+		s->latency_ns = 0;
+		s->max_latency_ns = 0;
+	}
+	if (num_active == 0)
+		return false;
+
+	if (num_worker <= 0)
+		num_worker = (int)std::thread::hardware_concurrency();
+	if (num_worker <= 0)
+		num_worker = 1;
+	if (num_worker > num_subject)
+		num_worker = num_subject;
+	this->num_worker = num_worker;
+
+	time_point_start = std::chrono::steady_clock::now();
+	running = true;
+	for (int w = 0; w < num_worker; w++)
+		worker[w] = std::thread(&SessionManager::RunWorker, this, w);
+
+	for (int i = 0; i < num_subject; i++)
+	{
+		Subject* s = subject[i];
+		s->worker_id = i % num_worker;
+		if (s->active)
+			s->reader = std::thread(&SessionManager::RunReader, this, s);
+	}
+
+	return true;
+}
+
+
+/*
+@brief	Stop & join the readers and the workers. Each reader finishes the frame it is reading ; queued packets are discarded.
+A reader waits at most 2 read time-outs for an insole that does not answer.
+*/
+void SessionManager::Stop()
+{
+	running = false;
+	for (int i = 0; i < num_subject; i++)
+	{
+		if (subject[i]->reader.joinable())
+			subject[i]->reader.join();
+	}
+
+	for (int w = 0; w < num_worker; w++)
+	{
+		worker_signal[w].Notify();
+		if (worker[w].joinable())
+			worker[w].join();
+	}
+}
+
+
+const std::string& SessionManager::getName(int subject_id)
+{
+	return subject[subject_id]->name;
+}
+
+
+/*
+@brief	Get the throughput & latency of one subject (safe while running)
+*/
+void SessionManager::getStats(int subject_id, SubjectStats* stats)
+{
+	const Subject* s = subject[subject_id];
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_point_start).count();
+
+	stats->active = s->active;
+	stats->frames = s->frames.load(std::memory_order_relaxed);
+	stats->dropped = s->dropped.load(std::memory_order_relaxed);
+	stats->timeouts = s->timeouts.load(std::memory_order_relaxed);
+	uint64_t num_read = stats->frames + stats->dropped;
+	stats->throughput = (elapsed > 0) ? stats->frames / elapsed : 0;
+	stats->mean_read = (num_read > 0) ? 1e-9 * s->read_ns.load(std::memory_order_relaxed) / num_read : 0;
+	stats->mean_latency = (stats->frames > 0) ? 1e-9 * s->latency_ns.load(std::memory_order_relaxed) / stats->frames : 0;
+	stats->max_latency = 1e-9 * s->max_latency_ns.load(std::memory_order_relaxed);
+	stats->heel_strikes = s->heel_strikes.load(std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Get the rolling gait summary of one subject (safe while running)
+*/
+void SessionManager::getSummary(int subject_id, GaitSummary* summary)
+{
+	Subject* s = subject[subject_id];
+	std::lock_guard<std::mutex> lock(s->summary_mutex);
+	*summary = s->summary;
+}
+
+
+/*
+@brief	Initialize the frame state & detectors of a subject, same settings as main.cpp
+This is an internal function, run by the reader of the subject before its 1st packet.
+*/
+void SessionManager::InitSubject(Subject* s)
+{
+	s->foot_sensor.setReadTimeout(read_timeout);
+	s->foot_sensor.FilterSpike_Init(s->serial_port, &(s->pressure_data));
+	s->foot_sensor.InitPressureFilter(8.0, 50.0, 2);
+	s->foot_sensor.InitCOPKalman(1000.0, 0.05, 5);
+	s->foot_sensor.InitGaitEvents(GaitEventConfig());
+	s->gait_metrics.Init(10);
+}
+
+
+/*
+@brief	Decode & process one packet of a subject
+This is an internal function, run by the worker of the subject.
+
+@param[in]	reading		packet read by the reader of the subject, with the time it was in hand
+*/
+void SessionManager::ProcessFrame(Subject* s, Subject::Reading* reading)
+{
+	PressureData* pressure_data = &(s->pressure_data);
+	FootSensor* foot_sensor = &(s->foot_sensor);
+
+	foot_sensor->DecodePressureData(&(reading->packet), pressure_data);
+	foot_sensor->CalcCOP(pressure_data);
+	foot_sensor->CalcContact(pressure_data);
+	foot_sensor->CalcFilteredCOP(pressure_data);
+	foot_sensor->CalcCOPKalman(pressure_data);
+
+	GaitEventRecord gait_events[2];
+	int num_event = foot_sensor->getGaitEvents(pressure_data, gait_events);
+	for (int i = 0; i < num_event; i++)
+	{
+		if (gait_events[i].event == kHeelStrike)
+			s->heel_strikes.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (s->gait_metrics.Update(gait_events, num_event) > 0)
+	{
+		std::lock_guard<std::mutex> lock(s->summary_mutex);
+		s->gait_metrics.getSummary(&(s->summary));
+	}
+
+	// Latency includes the time the packet waited for the worker
+	auto time_point_end = std::chrono::steady_clock::now();
+	uint64_t latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time_point_end - reading->time_point_read).count();
+	s->latency_ns.fetch_add(latency, std::memory_order_relaxed);
+	if (latency > s->max_latency_ns.load(std::memory_order_relaxed))
+		s->max_latency_ns.store(latency, std::memory_order_relaxed);
+	s->frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*
+@brief	Reader thread of one subject : serial reads (with a time-out), back to back, queued for the worker of the subject
+This is an internal function.
+*/
+void SessionManager::RunReader(Subject* s)
+{
+	InitSubject(s);
+
+	Subject::Reading reading;
+	while (running.load(std::memory_order_relaxed))
+	{
+		auto time_point_begin = std::chrono::steady_clock::now();
+		bool complete = s->foot_sensor.ReadPressurePacket(s->serial_port, &(reading.packet));
+		reading.time_point_read = std::chrono::steady_clock::now();
+
+		// No complete answer in time : nothing to process, check for Stop() & ask again
+		if (!complete)
+		{
+			s->timeouts.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		uint64_t read = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(reading.time_point_read - time_point_begin).count();
+		s->read_ns.fetch_add(read, std::memory_order_relaxed);
+
+		// The worker fell behind : drop the new packet, never delay the next read
+		if (!s->queue.Push(reading))
+		{
+			s->dropped.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+		worker_signal[s->worker_id].Notify();
+	}
+}
+
+
+/*
+@brief	Worker thread : processes the packets of subjects worker_id, worker_id + num_worker, ... as they arrive
+This is an internal function.
+*/
+void SessionManager::RunWorker(int worker_id)
+{
+	Subject::Reading reading;
+	while (running.load(std::memory_order_relaxed))
+	{
+		bool processed = false;
+		for (int i = worker_id; i < num_subject; i += num_worker)
+		{
+			Subject* s = subject[i];
+			while (s->active && s->queue.Pop(&reading))
+			{
+				ProcessFrame(s, &reading);
+				processed = true;
+			}
+		}
+
+		// Sleep until a reader queues a packet
+		if (!processed)
+			worker_signal[worker_id].Wait([this, worker_id]() {
+				return !running.load(std::memory_order_relaxed) || hasPacket(worker_id);
+			}, 0.1);
+	}
+}
+
+
+/*
+@brief	Check for a queued packet of any subject of a worker
+This is an internal function.
+*/
+bool SessionManager::hasPacket(int worker_id)
+{
+	for (int i = worker_id; i < num_subject; i += num_worker)
+	{
+		if (!subject[i]->queue.isEmpty())
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,125 @@
+#ifndef SESSION_MANAGER_HPP
+#define SESSION_MANAGER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "foot_sensor.hpp"
+#include "gait_metrics.hpp"
+#include "spsc_queue.hpp"
+#include "wake_signal.hpp"
+
+
+// Throughput & latency of one subject, see SessionManager::getStats()
+struct SubjectStats
+{
+	bool active;			// false -> its ports could not be opened
+	uint64_t frames;		// frames processed
+	double throughput;		// frames per second since Start()
+	double mean_read;		// mean time of reading both foot-sensors (in seconds)
+	double mean_latency;	// mean time from the data in hand to the end of processing (in seconds)
+	double max_latency;
+	uint64_t dropped;		// frames read but dropped because its worker fell behind
+	uint64_t timeouts;		// reads without a complete answer in time (e.g. unplugged insole)
+	uint64_t heel_strikes;	// of both feet
+};
+
+
+/**
+* Several subjects (insole pairs) served by one host, e.g. 8-16 patients of a rehab gym
+*
+* Each subject owns its serial ports, FootSensor (frame state, filters & detectors), PressureData & GaitMetrics,
+* so subjects are fully independent.
+* Each subject has its own reader thread for the blocking serial request / response (FootSensor::ReadPressurePacket()),
+* so the subjects are read in parallel, each at the rate of its own insoles.
+* Every read has a time-out, so an insole that stops answering (e.g. unplugged) never keeps Stop() from joining its reader.
+* The packets are processed by a pool of worker threads sized to the machine, through a lock-free queue per subject ;
+* a subject is always processed by the same worker, so no lock is needed on the per-frame path.
+* Idle workers sleep until a reader hands them a packet. Counters & gait summaries can be read from any thread while running.
+*/
+class SessionManager
+{
+public:
+	static const int max_subject = 32;
+	static const int queue_size = 8;	// packets waiting for the worker of a subject (power of two)
+	static const int read_timeout = 100;	// of each serial read (in ms), one answer takes ~18 ms
+
+	SessionManager();
+	~SessionManager();
+
+	int AddSubject(const std::string& name, const std::string& comport_left, const std::string& comport_right);
+
+	bool Start(int num_worker = 0);
+
+	void Stop();
+
+	int getNumSubject() { return num_subject; }
+
+	int getNumWorker() { return num_worker; }
+
+	const std::string& getName(int subject_id);
+
+	void getStats(int subject_id, SubjectStats* stats);
+
+	void getSummary(int subject_id, GaitSummary* summary);
+
+private:
+	struct Subject
+	{
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+		std::string name;
+		std::string comport[2];
+		bool active = false;
+
+		USBStream serial_port[2];
+		FootSensor foot_sensor;
+		PressureData pressure_data;
+		GaitMetrics gait_metrics;
+
+		// Packets read by the reader thread, processed by the worker
+		struct Reading
+		{
+			PressurePacket packet;
+			std::chrono::time_point<std::chrono::steady_clock> time_point_read;
+		};
+		SPSCQueue<Reading, queue_size> queue;
+		std::thread reader;
+		int worker_id = 0;
+
+		std::atomic<uint64_t> frames;
+		std::atomic<uint64_t> dropped;
+		std::atomic<uint64_t> timeouts;
+		std::atomic<uint64_t> heel_strikes;
+		std::atomic<uint64_t> read_ns;
+		std::atomic<uint64_t> latency_ns;
+		std::atomic<uint64_t> max_latency_ns;
+
+		std::mutex summary_mutex;
+		GaitSummary summary;		// copy of gait_metrics, updated at every stride
+	};
+
+	Subject* subject[max_subject];
+	int num_subject = 0;
+
+	std::thread worker[max_subject];
+	WakeSignal worker_signal[max_subject];	// a reader queued a packet for this worker
+	int num_worker = 0;
+	std::atomic<bool> running;
+	std::chrono::time_point<std::chrono::steady_clock> time_point_start;
+
+	void InitSubject(Subject* s);
+
+	void ProcessFrame(Subject* s, Subject::Reading* reading);
+
+	void RunReader(Subject* s);
+
+	void RunWorker(int worker_id);
+
+	bool hasPacket(int worker_id);
+};
+
+
+#endif // SESSION_MANAGER_HPP
@@ -0,0 +1,63 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+* Bounded lock-free queue for exactly ONE producer thread and ONE consumer thread
+*
+* Ring buffer of Capacity elements (power of two), with the read & write counters
+* on separate cache-lines so producer and consumer do not false-share.
+* Push/Pop never block nor allocate : they return false when the queue is full/empty,
+* the caller decides to wait or drop.
+*/
+template <typename T, int Capacity>
+class SPSCQueue
+{
+	static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	SPSCQueue() : head(0), tail(0) {}
+
+	// Producer only
+	bool Push(const T& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= (size_t)Capacity)
+			return false;
+
+		buffer[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only
+	bool Pop(T* item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		*item = buffer[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Approximate when called from a 3rd thread
+	int size() const { return (int)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)); }
+
+	bool isEmpty() const { return size() == 0; }
+
+	// Not thread-safe : only when neither producer nor consumer is running
+	void Clear() { head.store(0); tail.store(0); }
+
+private:
+	alignas(64) std::atomic<size_t> head;	// next item to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail;	// next free slot, written by the producer
+	alignas(64) T buffer[Capacity];
+};
+
+
+#endif // SPSC_QUEUE_HPP
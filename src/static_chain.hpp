@@ -0,0 +1,188 @@
+#ifndef STATIC_CHAIN_HPP
+#define STATIC_CHAIN_HPP
+
+#include <chrono>
+
+#include "foot_sensor.hpp"
+
+
+/** Compile-time composed processing chain, for minimum-latency builds (e.g. the exoskeleton controller)
+*
+* A chain is a list of stage TYPES : StaticChain<Decode, COP, SpikeFilter, HeelStrikePredictive>.
+* Run() unrolls into one inline sequence of calls at compile time : no virtual dispatch, no function pointers, no queues.
+* The stages call the same FootSensor methods as the other paths, so results are identical.
+* (Build with link-time optimization so the compiler can also inline the FootSensor methods, see CMakeLists.txt.)
+*
+* A stage is any type with :	static void Run(ChainContext* context)
+*/
+
+
+// Everything a stage reads or writes
+struct ChainContext
+{
+	FootSensor* foot_sensor;
+	USBStream* serial_port;
+	PressureData* pressure_data;
+	const PressureFrame* frame = NULL;		// recorded frame read by ChainReplay, instead of the foot-sensors
+
+	bool spike_check[2] = { true, true };	// see FootSensor::FilterSpike()
+	int heel_strike = 0;					// decision of the chain : 0 -> nothing ; 1 -> left-heel-strike ; 2 -> right
+
+	// Time the sensor data is in hand, set by ChainDecode / ChainReplay
+	std::chrono::time_point<std::chrono::steady_clock> time_point_read;
+};
+
+
+// Read & decode the foot-sensors
+struct ChainDecode
+{
+	static inline void Run(ChainContext* context)
+	{
+		context->foot_sensor->ReadPressureData(context->serial_port, context->pressure_data);
+		context->time_point_read = std::chrono::steady_clock::now();
+	}
+};
+
+// Take the recorded frame instead of reading the foot-sensors (same chain, offline), see HeelStrikeReplayChain
+struct ChainReplay
+{
+	static inline void Run(ChainContext* context)
+	{
+		const PressureFrame* frame = context->frame;
+		PressureData* pressure_data = context->pressure_data;
+		int* left = pressure_data->sensor_left.data();
+		int* right = pressure_data->sensor_right.data();
+
+		bool left_all_zero = true, right_all_zero = true;
+		for (int i = 0; i < PressureData::sensor_size; i++)
+		{
+			left[i] = frame->cells[0][i];
+			right[i] = frame->cells[1][i];
+			left_all_zero = left_all_zero && (left[i] == 0);
+			right_all_zero = right_all_zero && (right[i] == 0);
+		}
+
+		pressure_data->time_stamp = frame->time_stamp;
+		pressure_data->frame_seq = frame->seq;
+		pressure_data->left_changed = true;
+		pressure_data->right_changed = true;
+		pressure_data->left_all_zero = left_all_zero;
+		pressure_data->right_all_zero = right_all_zero;
+		context->time_point_read = std::chrono::steady_clock::now();
+	}
+};
+
+// Pressure-sum & COP (needed by the spike filter & heel strike)
+struct ChainCOP
+{
+	static inline void Run(ChainContext* context)
+	{
+		context->foot_sensor->CalcCOP(context->pressure_data);
+	}
+};
+
+// Pressure-gradiant & spike rejection
+struct ChainSpikeFilter
+{
+	static inline void Run(ChainContext* context)
+	{
+		context->foot_sensor->FilterSpike(context->pressure_data, context->spike_check);
+	}
+};
+
+// Heel-strike decision on the 1st frame of heel loading (see FootSensor::InitHeelStrike_Predictive())
+struct ChainHeelStrikePredictive
+{
+	static inline void Run(ChainContext* context)
+	{
+		context->heel_strike = context->foot_sensor->getHeelStrike_Predictive(context->pressure_data);
+	}
+};
+
+
+template <typename... Stages>
+struct StaticChain;
+
+template <>
+struct StaticChain<>
+{
+	static const int num_stage = 0;
+
+	static inline void Run(ChainContext* context) {}
+
+	static inline void RunProfiled(ChainContext* context, double* stage_time) {}
+};
+
+template <typename First, typename... Rest>
+struct StaticChain<First, Rest...>
+{
+	static const int num_stage = 1 + sizeof...(Rest);
+
+	static inline void Run(ChainContext* context)
+	{
+		First::Run(context);
+		StaticChain<Rest...>::Run(context);
+	}
+
+	// Same as Run(), with the time of each stage (in seconds) in stage_time[num_stage]
+	static inline void RunProfiled(ChainContext* context, double* stage_time)
+	{
+		auto time_point_begin = std::chrono::steady_clock::now();
+		First::Run(context);
+		stage_time[0] = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_point_begin).count();
+
+		StaticChain<Rest...>::RunProfiled(context, stage_time + 1);
+	}
+};
+
+
+// The fixed sensor-to-decision chain of the exoskeleton
+typedef StaticChain<ChainDecode, ChainCOP, ChainSpikeFilter, ChainHeelStrikePredictive> HeelStrikeChain;
+
+// Same chain on a recorded session (set ChainContext::frame before each Run()), to check its decisions offline
+typedef StaticChain<ChainReplay, ChainCOP, ChainSpikeFilter, ChainHeelStrikePredictive> HeelStrikeReplayChain;
+
+
+/**
+* Sensor-to-decision latency of a chain : from the sensor data in hand (end of ChainDecode) to the end of the chain
+*
+* A budget can be set to lock in the latency : frames above it are counted.
+*/
+class ChainLatency
+{
+public:
+	ChainLatency(double budget = 1e-3) : budget(budget) {}
+
+	template <typename Chain>
+	int Run(ChainContext* context)
+	{
+		Chain::Run(context);
+
+		double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - context->time_point_read).count();
+		count++;
+		total += latency;
+		if (latency > max)
+			max = latency;
+		if (latency > budget)
+			over_budget++;
+
+		return context->heel_strike;
+	}
+
+	void Reset() { count = 0; over_budget = 0; total = 0; max = 0; }
+
+	uint64_t getCount() const { return count; }
+	uint64_t getOverBudget() const { return over_budget; }
+	double getMean() const { return (count > 0) ? total / count : 0; }
+	double getMax() const { return max; }
+
+private:
+	double budget;				// in seconds
+	uint64_t count = 0;
+	uint64_t over_budget = 0;
+	double total = 0;
+	double max = 0;
+};
+
+
+#endif // STATIC_CHAIN_HPP
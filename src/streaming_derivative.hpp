@@ -0,0 +1,175 @@
+#ifndef STREAMING_DERIVATIVE_HPP
+#define STREAMING_DERIVATIVE_HPP
+
+#include <cmath>
+
+#include "Eigen/Dense"
+
+
+/** Savitzky-Golay coefficients of the first derivative at the NEWEST sample
+*
+* Quadratic least-squares fit over N uniformly spaced samples, evaluated at the last sample (causal, no delay).
+* coeff(j) is for sample j, from the oldest (j = 0) to the newest (j = N-1).
+* derivative = sum(coeff(j) * value[j]) / (norm * h), with h the sample interval.
+*/
+template <int N> struct SavitzkyGolayTable;
+
+template <> struct SavitzkyGolayTable<5>
+{
+	static int norm() { return 70; }
+	static int coeff(int j)
+	{
+		static const int c[5] = { 26, -27, -40, -13, 54 };
+		return c[j];
+	}
+};
+
+template <> struct SavitzkyGolayTable<7>
+{
+	static int norm() { return 28; }
+	static int coeff(int j)
+	{
+		static const int c[7] = { 7, -2, -7, -8, -5, 2, 13 };
+		return c[j];
+	}
+};
+
+template <> struct SavitzkyGolayTable<9>
+{
+	static int norm() { return 4620; }
+	static int coeff(int j)
+	{
+		static const int c[9] = { 812, 49, -474, -757, -800, -603, -166, 511, 1428 };
+		return c[j];
+	}
+};
+
+
+/**
+* Streaming first-derivative estimator over a short ring of the last N samples (N = 5, 7 or 9)
+*
+* When the time-stamps of the ring are uniform (within jitter_tolerance of the mean interval),
+* the compile-time Savitzky-Golay table is used.
+* Otherwise the same quadratic least-squares fit is solved with the REAL time-stamps ([3x3] normal equations).
+* Until N samples are available, a two-point difference is returned.
+*
+* Created to replace the two-point gradients of FootSensor, which are very sensitive to noise.
+*/
+template <int N>
+class StreamingDerivative
+{
+public:
+	StreamingDerivative() { Reset(); }
+
+	/** @brief Clear the ring
+	*/
+	void Reset()
+	{
+		head = 0;
+		count = 0;
+		derivative = 0;
+	}
+
+	/** @brief Push a new sample and estimate the derivative at this sample
+	*
+	* @param[in] value the new sample
+	* @param[in] time_stamp time-stamp of the sample (in seconds)
+	*
+	* @return returns the derivative (unit of value per second)
+	*/
+	float Update(float value, double time_stamp)
+	{
+		head = (head + 1) % N;
+		values[head] = value;
+		times[head] = time_stamp;
+		if (count < N)
+			count++;
+
+		derivative = Estimate();
+		return derivative;
+	}
+
+	/** @brief Overwrite the newest sample (e.g. after a spike was rejected) and estimate again
+	*
+	* @param[in] value the corrected sample
+	*
+	* @return returns the derivative (unit of value per second)
+	*/
+	float ReplaceLast(float value)
+	{
+		if (count > 0)
+		{
+			values[head] = value;
+			derivative = Estimate();
+		}
+		return derivative;
+	}
+
+	float getDerivative() { return derivative; }
+
+	void setJitterTolerance(float tolerance) { jitter_tolerance = tolerance; }
+
+private:
+	float values[N];
+	double times[N];
+	int head;			// index of the newest sample
+	int count;			// valid samples in the ring
+	float derivative;
+	float jitter_tolerance = 0.1f;	// fraction of the mean interval
+
+	// index of the j-th sample, 0 -> oldest ; N-1 -> newest
+	int at(int j) { return (head + 1 + j) % N; }
+
+	float Estimate()
+	{
+		if (count < 2)
+			return 0;
+
+		if (count < N)
+		{
+			int prev = (head + N - 1) % N;
+			double dt = times[head] - times[prev];
+			return (dt > 0) ? float((values[head] - values[prev]) / dt) : 0;
+		}
+
+		double span = times[at(N - 1)] - times[at(0)];
+		if (span <= 0)
+			return 0;
+		double h = span / (N - 1);
+
+		bool uniform = true;
+		for (int j = 1; j < N; j++)
+		{
+			double interval = times[at(j)] - times[at(j - 1)];
+			if (std::fabs(interval - h) > jitter_tolerance * h)
+			{
+				uniform = false;
+				break;
+			}
+		}
+
+		if (uniform)
+		{
+			double sum = 0;
+			for (int j = 0; j < N; j++)
+				sum += SavitzkyGolayTable<N>::coeff(j) * double(values[at(j)]);
+			return float(sum / (SavitzkyGolayTable<N>::norm() * h));
+		}
+
+		// Quadratic fit value = b0 + b1*t + b2*t^2 with t relative to the newest sample, derivative = b1
+		Eigen::Matrix3d ATA = Eigen::Matrix3d::Zero();
+		Eigen::Vector3d ATy = Eigen::Vector3d::Zero();
+		for (int j = 0; j < N; j++)
+		{
+			double t = (times[at(j)] - times[head]) / h;	// normalised for conditioning
+			Eigen::Vector3d a(1, t, t * t);
+			ATA += a * a.transpose();
+			ATy += a * double(values[at(j)]);
+		}
+		Eigen::Vector3d b = ATA.ldlt().solve(ATy);
+		return float(b(1) / h);
+	}
+};
+
+
+#endif // STREAMING_DERIVATIVE_HPP
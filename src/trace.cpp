@@ -0,0 +1,136 @@
+#include "trace.hpp"
+
+#if defined(ENABLE_TRACE)
+
+#include <atomic>
+#include <cstdio>
+
+
+// Ring of one thread : written by that thread only, read by Dump()
+struct TraceRing
+{
+	alignas(64) std::atomic<uint64_t> count;	// records written so far
+	const char* thread_name;
+	TraceRecord record[Trace::ring_size];
+};
+
+static TraceRing rings[Trace::max_thread];
+static std::atomic<int> num_ring(0);
+static std::atomic<uint64_t> num_lost(0);		// records of threads beyond max_thread
+
+static thread_local TraceRing* thread_ring = NULL;
+static thread_local bool thread_full = false;
+
+
+/*
+@brief	Ring of the calling thread, taken at its 1st record
+This is an internal function.
+*/
+static TraceRing* getRing()
+{
+	if (thread_ring || thread_full)
+		return thread_ring;
+
+	int index = num_ring.fetch_add(1);
+	if (index >= Trace::max_thread)
+	{
+		thread_full = true;
+		return NULL;
+	}
+
+	thread_ring = &rings[index];
+	return thread_ring;
+}
+
+
+/*
+@brief	Write one record in the ring of the calling thread (the oldest record is overwritten when full)
+Called by the TRACE_ macros.
+*/
+void Trace::Record(const char* name, int64_t begin_ns, int64_t duration_ns, int64_t arg)
+{
+	TraceRing* ring = getRing();
+	if (!ring)
+	{
+		num_lost.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	uint64_t count = ring->count.load(std::memory_order_relaxed);
+	TraceRecord& r = ring->record[count & (ring_size - 1)];
+	r.name = name;
+	r.begin_ns = begin_ns;
+	r.duration_ns = duration_ns;
+	r.arg = arg;
+	ring->count.store(count + 1, std::memory_order_release);
+}
+
+
+/*
+@brief	Name of the calling thread in the timeline, e.g. "acquisition" (string literal)
+*/
+void Trace::setThreadName(const char* name)
+{
+	TraceRing* ring = getRing();
+	if (ring)
+		ring->thread_name = name;
+}
+
+
+/*
+@brief	Write the records of all threads as Chrome trace JSON (opens in chrome://tracing & Perfetto)
+
+@param[in]	filename	e.g. "foot_sensor_trace.json"
+@return	false if the file cannot be written
+*/
+bool Trace::Dump(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool first = true;
+
+	int n = num_ring.load();
+	if (n > max_thread)
+		n = max_thread;
+
+	for (int t = 0; t < n; t++)
+	{
+		const TraceRing& ring = rings[t];
+		int tid = t + 1;
+
+		if (ring.thread_name)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", tid, ring.thread_name);
+			first = false;
+		}
+
+		uint64_t count = ring.count.load(std::memory_order_acquire);
+		uint64_t begin = (count > (uint64_t)ring_size) ? count - ring_size : 0;
+		for (uint64_t i = begin; i < count; i++)
+		{
+			const TraceRecord& r = ring.record[i & (ring_size - 1)];
+			if (r.duration_ns < 0)
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+					first ? "" : ",\n", r.name, tid, r.begin_ns * 1e-3);
+			else
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%lld}}",
+					first ? "" : ",\n", r.name, tid, r.begin_ns * 1e-3, r.duration_ns * 1e-3, (long long)r.arg);
+			first = false;
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	bool success = (ferror(file) == 0);
+	fclose(file);
+
+	if (num_lost.load() > 0)
+		fprintf(stderr, "Trace: %llu records lost (more than %d threads)\n", (unsigned long long)num_lost.load(), max_thread);
+	return success;
+}
+
+
+#endif // ENABLE_TRACE
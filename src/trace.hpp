@@ -0,0 +1,87 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <stdint.h>
+#include <chrono>
+
+
+/** Trace points of individual frames, dumped as a Chrome trace (chrome://tracing, https://ui.perfetto.dev)
+*
+* Built with ENABLE_TRACE defined (cmake -DTRACE=ON), each trace point writes one fixed-size record
+* into a ring of the calling thread (no lock, no allocation, no system call) :
+*	TRACE_SCOPE("name")				time spent until the end of the enclosing scope
+*	TRACE_SCOPE_ARG("name", arg)	same, with an integer argument (e.g. the serial port)
+*	TRACE_INSTANT("name")			a point in time (e.g. a dropped frame)
+* Names must be string literals (only the pointer is stored). Each ring keeps the last ring_size records of its thread.
+* Trace::Dump() writes all rings to a JSON file, best after the traced threads stopped.
+*
+* Without ENABLE_TRACE the macros expand to nothing and the Trace functions are empty : zero overhead.
+*/
+
+
+// One record of a trace ring
+struct TraceRecord
+{
+	const char* name;
+	int64_t begin_ns;		// steady_clock
+	int64_t duration_ns;	// -1 -> instant event
+	int64_t arg;
+};
+
+
+class Trace
+{
+public:
+	static const int max_thread = 32;
+	static const int ring_size = 4096;	// records per thread (power of two)
+
+#if defined(ENABLE_TRACE)
+	static void Record(const char* name, int64_t begin_ns, int64_t duration_ns, int64_t arg);
+
+	static void setThreadName(const char* name);
+
+	static bool Dump(const char* filename);
+#else
+	static void Record(const char* /*name*/, int64_t /*begin_ns*/, int64_t /*duration_ns*/, int64_t /*arg*/) {}
+
+	static void setThreadName(const char* /*name*/) {}
+
+	static bool Dump(const char* /*filename*/) { return false; }
+#endif
+
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+
+// Records the lifetime of a scope, see TRACE_SCOPE
+class TraceScope
+{
+public:
+	TraceScope(const char* name, int64_t arg = 0) : name(name), arg(arg), begin_ns(Trace::Now()) {}
+
+	~TraceScope() { Trace::Record(name, begin_ns, Trace::Now() - begin_ns, arg); }
+
+private:
+	const char* name;
+	int64_t arg;
+	int64_t begin_ns;
+};
+
+
+#if defined(ENABLE_TRACE)
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, (int64_t)(arg))
+#define TRACE_INSTANT(name) Trace::Record(name, Trace::Now(), -1, 0)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_SCOPE_ARG(name, arg) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#endif
+
+
+#endif // TRACE_HPP
@@ -0,0 +1,66 @@
+#ifndef WAKE_SIGNAL_HPP
+#define WAKE_SIGNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+
+/**
+* Puts ONE consumer thread to sleep until a producer has something for it, e.g. a lock-free queue is not empty anymore
+*
+* The consumer sleeps in the kernel (futex) instead of spinning, so an idle thread costs no CPU,
+* and a SCHED_FIFO thread never keeps its core from the other tasks.
+* Notify() only takes the mutex when the consumer actually sleeps : a producer that finds it awake
+* pays one fence & one load. Same handshake as GaitEventBus::Wait().
+*/
+class WakeSignal
+{
+public:
+	WakeSignal() : waiting(false) {}
+
+	/** @brief Sleep until ready() is true, Notify() is called or the timeout expires (consumer only)
+	*
+	* @param[in]	ready	condition checked after announcing the sleep, so no notification is lost
+	* @param[in]	timeout	maximum sleeping time (in seconds)
+	* @return	ready() when returning
+	*/
+	template <typename Predicate>
+	bool Wait(Predicate ready, double timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);	// pairs with the one in Notify()
+
+		bool is_ready = ready();
+		if (!is_ready)
+		{
+			condition.wait_for(lock, std::chrono::duration<double>(timeout));
+			is_ready = ready();
+		}
+
+		waiting.store(false, std::memory_order_relaxed);
+		return is_ready;
+	}
+
+	/** @brief Wake the consumer up if it sleeps (any thread, after making the condition true)
+	*/
+	void Notify()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiting.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			condition.notify_one();
+		}
+	}
+
+private:
+	std::atomic<bool> waiting;		// consumer is (about to be) asleep in Wait()
+	std::mutex mutex;
+	std::condition_variable condition;
+};
+
+
+#endif // WAKE_SIGNAL_HPP